@@ -0,0 +1,69 @@
+#include "fuzzy.hpp"
+#include "threadpool.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Measures the time per keystroke of the fuzzy filter for 1 to N threads
+ * Usage: ./benchmark [entries]
+ */
+int main(int argc, char** argv){
+    std::size_t amount = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000);
+    const char* words[] = {"alpha", "beta", "gamma", "delta", "prod", "stage", "web", "db", "cache", "eu", "us", "west", "east"};
+
+    std::mt19937 random(1);
+    std::vector<std::string> entries;
+    entries.reserve(amount);
+    for(std::size_t i = 0; i < amount; i++){
+        std::string entry;
+        for(int k = 0; k < 3; k++){
+            entry += words[random() % 13];
+            entry += '-';
+        }
+        entry += std::to_string(i);
+        entries.push_back(entry);
+    }
+
+    const char* query = "webdb3";
+    std::size_t length = std::char_traits<char>::length(query);
+
+    unsigned int hardware = std::thread::hardware_concurrency();
+    hardware = (hardware > 0 ? hardware : 1);
+    std::printf("%zu entries, query \"%s\"\n", amount, query);
+    std::printf("%8s %14s %10s\n", "threads", "ms/keystroke", "speedup");
+
+    double single = 0;
+    for(unsigned int threads = 1; threads <= hardware; threads *= 2){
+        haevn::utils::ThreadPool pool(threads);
+        haevn::utils::FuzzyFilter filter;
+
+        // Computes the signatures once
+        filter.filter(entries, query, &pool);
+
+        // Keystrokes which extend the query, these are not served from the stored prefixes
+        double total = 0;
+        int repetitions = 3;
+        for(int repetition = 0; repetition < repetitions; repetition++){
+            filter.filter(entries, "", &pool);
+            for(std::size_t i = 1; i <= length; i++){
+                auto start = std::chrono::steady_clock::now();
+                filter.filter(entries, std::string_view(query, i), &pool);
+                total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            }
+        }
+        double average = total / (repetitions * length);
+        single = (threads == 1 ? average : single);
+        std::printf("%8u %14.2f %9.2fx\n", threads, average, single / average);
+
+        if(threads < hardware && threads * 2 > hardware){
+            threads = hardware / 2;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,4 @@
+#!/bin/bash
+rm benchmark
+g++ -O2 -march=native -pthread benchmark.cpp -o benchmark
+./benchmark "$@"
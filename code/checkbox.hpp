@@ -43,9 +43,19 @@
  */
 #pragma once
 
+#include "colors.hpp"
 #include "keyboard.hpp"
+#include "screen.hpp"
+#include "fuzzy.hpp"
+#include "selectionset.hpp"
+#include "provider.hpp"
+#include "eventloop.hpp"
+#include "histogram.hpp"
+#include "trace.hpp"
 
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace haevn::terminal::widgets{
@@ -89,12 +99,12 @@ namespace haevn::terminal::widgets{
         /**
          * @brief Background color
          */
-        const char* background = terminal::colors::background::CYAN;
+        terminal::colors::Style background = terminal::colors::style::background::CYAN;
 
         /**
          * @brief Hightlighting color
          */
-        const char* foreground = terminal::colors::foreground::BLACK;
+        terminal::colors::Style foreground = terminal::colors::style::foreground::BLACK;
 
         /**
          * @brief Row selection indicator
@@ -110,18 +120,117 @@ namespace haevn::terminal::widgets{
          * @brief Navigate DOWN keybind
          */
         char down_key = 's';
+
+        /**
+         * @brief Maximum amount of entries which are displayed at once
+         * @details 0 fits the entries to the terminal height
+         */
+        int visible_rows = 0;
+
+        /**
+         * @brief Enables type to filter
+         * @details Typed characters narrow the entries by fuzzy matching, BACKSPACE removes the
+         *          last character and ESC clears the filter or returns if no filter is set.
+         *          Only the arrow keys navigate while the filter is enabled.
+         */
+        bool filter = false;
+
+        /**
+         * @brief Color of matched characters
+         */
+        terminal::colors::Style match_highlight = terminal::colors::style::foreground::YELLOW;
+
+        /**
+         * @brief Select all keybind, CTRL+A selects every match while the filter is enabled
+         */
+        char select_all_key = '+';
+
+        /**
+         * @brief Deselect all keybind, CTRL+D deselects every match while the filter is enabled
+         */
+        char deselect_all_key = '-';
+
+        /**
+         * @brief Invert keybind, CTRL+T inverts every match while the filter is enabled
+         */
+        char invert_key = '*';
+
+        /**
+         * @brief Reads the initial selection from and writes the result to CheckBoxEntry::selected
+         * @details Disable it for huge lists and use CheckBox::selection() or the returned indices
+         */
+        bool update_entries = true;
+
+        /**
+         * @brief Interval in milliseconds in which a growing provider is redrawn
+         */
+        int refresh_interval = 100;
     };
 
     class CheckBox{
     private:
-            std::vector<CheckBoxEntry>& entries;
+            /**
+             * @brief Entries of a vector based check box, nullptr for a provider based one
+             */
+            std::vector<CheckBoxEntry>* entries;
+
+            /**
+             * @brief Provider which is owned by the check box, if it was constructed from a vector
+             */
+            std::unique_ptr<utils::EntryProvider> owned;
+
+            /**
+             * @brief Texts of the entries
+             */
+            utils::EntryProvider& texts;
             std::string& message;
             CheckBoxSettings* settings_t;
+            utils::FuzzyFilter filter;
+            utils::SelectionSet selection_t;
+
+            /**
+             * @brief Matched positions of the printed entry
+             */
+            std::vector<std::size_t> positions;
+
+            /**
+             * @brief State of the running selection
+             */
+            Screen screen;
+            std::string query;
+            int row = 0;
+            int anchor = 0;
+            int top = 0;
+            int visible = 1;
+            int size = 0;
+            bool filtered = true;
+            bool update_entries = false;
+            std::size_t total = 0;
+
+            /**
+             * @brief Projection from an entry to its text
+             */
+            struct Text{
+                const std::string& operator()(const CheckBoxEntry& entry) const{
+                    return entry.text;
+                }
+            };
     
     public:
 
         CheckBox(std::vector<CheckBoxEntry>& entries_t, std::string& message_t)
-             : entries(entries_t), message(message_t){
+             : entries(&entries_t), owned(std::make_unique<utils::VectorProvider<CheckBoxEntry, Text>>(entries_t)), texts(*owned), message(message_t){
+            settings_t = new CheckBoxSettings();
+        }
+
+        /**
+         * @brief Construct a new check box which pulls its texts from a provider
+         * @details The selection is only stored inside selection(), update_entries is ignored
+         * @param provider Source of the texts, must outlive the check box
+         * @param message_t Header of the check box
+         */
+        CheckBox(utils::EntryProvider& provider, std::string& message_t)
+             : entries(nullptr), texts(provider), message(message_t){
             settings_t = new CheckBoxSettings();
         }
 
@@ -132,67 +241,399 @@ namespace haevn::terminal::widgets{
         CheckBoxSettings* settings(){
             return settings_t;
         }
+
+        /**
+         * @brief Gets the selection state of the entries
+         * @details Index i belongs to entries[i], the set is kept between calls of selectItems
+         */
+        utils::SelectionSet& selection(){
+            return selection_t;
+        }
         
-        void selectItems(){
-            char c = 'D';
-            int row = 0;
+        /**
+         * @brief Prints the check boxes on the terminal
+         * @details Only the entries which fit the terminal are rendered. With the filter setting
+         *          typed characters narrow the entries, large lists are filtered in parallel by
+         *          the shared thread pool and a running filter is cancelled by the next key.
+         *          The selection is stored as a bitset, selecting, deselecting or inverting all
+         *          entries does not touch the entries. INS selects the rows between the last
+         *          toggled row and the current row.
+         * @return std::vector<std::uint32_t> Ascending indices of the selected entries
+         */
+        std::vector<std::uint32_t> selectItems(){
+            utils::TerminalSession session;
+            start();
+            while(true){
+                refresh(session);
+                if(handle(utils::KeyDecoder::read(session, timeout()))){
+                    break;
+                }
+            }
+            return finish();
+        }
+
+#if defined(HAEVN_COROUTINES)
+        /**
+         * @brief Prints the check boxes on the terminal without blocking the event loop
+         * @details Asynchronous counterpart of selectItems, other tasks of the loop keep
+         *          running while the check boxes wait for keys
+         * @param loop Event loop which drives the check boxes
+         * @return utils::Task<std::vector<std::uint32_t>> Ascending indices of the selected entries
+         */
+        utils::Task<std::vector<std::uint32_t>> selectItemsAsync(utils::EventLoop& loop){
+            utils::EventLoop::Terminal terminal = co_await loop.terminal();
+            utils::TerminalSession session;
+            start();
+            while(true){
+                refresh(session);
+                if(handle(co_await terminal.key(session, timeout()))){
+                    break;
+                }
+            }
+            co_return finish();
+        }
+#endif
+    private:
+
+        /**
+         * @brief Starts a selection
+         */
+        void start(){
+            row = 0;
+            anchor = 0;
+
+            update_entries = (entries != nullptr && settings()->update_entries);
+            if(update_entries){
+                selection_t.resize(entries->size());
+                selection_t.clear();
+                for(std::size_t i = 0; i < entries->size(); i++){
+                    if((*entries)[i].selected){
+                        selection_t.set(i, true);
+                    }
+                }
+            }else if(selection_t.size() != texts.size()){
+                selection_t.resize(texts.size());
+            }
 
             if(settings()->clear_cache){
                 char c2;
                 while ((c2 = haevn::utils::Getchar::getch()) != '\n' && c2 != EOF) { }
             }
 
-            while(true){
-                std::system("clear");
-                std::cout << terminal::colors::CLEAR << utils::dateTime() << std::endl
-                          << "Use " << settings()->up_key << "/" << settings()->down_key << " to navigate, <ENTER> to check/uncheck and q to return" << std::endl
-                          << message << std::endl;    
-                if(settings()->sub_header.size() > 0){
-                    std::cout << settings()->sub_header << std::endl;
-                }
-                std::cout << std::endl;
-                    
-                for(int i = 0; i < entries.size(); i++){
-                    printEntry(entries.at(i).text, i, row);
+            size = texts.size();
+            top = 0;
+            visible = 1;
+            query.clear();
+            filtered = true;
+            total = texts.size();
+            if(settings()->filter){
+                filter.reset();
+            }
+        }
+
+        /**
+         * @brief Applies a pending filter and draws a frame
+         * @details A key typed meanwhile cancels the filter, no frame is drawn then
+         * @param session Session which provides the input
+         */
+        void refresh(utils::TerminalSession& session){
+            HAEVN_TRACE_SCOPE("checkbox", "filter");
+            if(!filtered){
+                if(texts.concurrent()){
+                    filtered = filter.filterInterruptible(texts, query, utils::ThreadPool::shared(), [&session]{ return session.wait(2); });
+                }else{
+                    filtered = filter.filter(texts, query);
                 }
+                size = (filter.active() ? filter.matches().size() : texts.size());
+                row = (row < size ? row : (size > 0 ? size - 1 : 0));
+            }
+
+            if(filtered){
+                draw();
+            }
+        }
+
+        /**
+         * @brief Gets the timeout for the next key
+         * @return int Refresh interval while the provider grows, otherwise -1
+         */
+        int timeout(){
+            return (texts.complete() ? -1 : settings()->refresh_interval);
+        }
 
-                c = utils::Getchar::getch();
-                if(c == settings()->up_key){
-                    row--;
-                    if(row < 0){
-                        row = ((settings()->row_selection_overflow) ? entries.size() - 1 : 0);
+        /**
+         * @brief Applies a key
+         * @param key Key which was typed, NONE if the timeout passed
+         * @return true If the check boxes should return
+         */
+        bool handle(utils::keys key){
+            HAEVN_TRACE_SCOPE("checkbox", "handle");
+            if(key == utils::keys::NONE){
+                // The provider grew meanwhile, only the new entries are matched against the filter
+                if(texts.size() != total){
+                    total = texts.size();
+                    selection_t.resize(total);
+                    if(filter.active() && filtered){
+                        filter.extend(texts, (texts.concurrent() ? &utils::ThreadPool::shared() : nullptr));
+                        size = filter.matches().size();
+                    }else if(!filter.active()){
+                        size = total;
                     }
                 }
+                return false;
+            }
+
+            if(settings()->filter){
+                std::size_t length = query.size();
+                if(key == utils::keys::ESC && length == 0){
+                    return true;
+                }
+                if(key >= utils::keys::SPACE && key < utils::keys::BACK_SPACE){
+                    query.push_back(static_cast<char>(key));
+                }else if(key == utils::keys::BACK_SPACE && length > 0){
+                    query.pop_back();
+                }else if(key == utils::keys::ESC){
+                    query.clear();
+                }
+                if(query.size() != length){
+                    filtered = false;
+                    row = 0;
+                    top = 0;
+                    return false;
+                }
+            }
+
+            bool up_key = (!settings()->filter && key == settings()->up_key);
+            bool down_key = (!settings()->filter && key == settings()->down_key);
+
+            if(up_key || key == utils::keys::ARROW_UP){
+                row--;
+                if(row < 0){
+                    row = ((settings()->row_selection_overflow) ? size - 1 : 0);
+                }
+            }
+
+            if(down_key || key == utils::keys::ARROW_DOWN){
+                row++;
+                if(row >= size){
+                    row = ((settings()->row_selection_overflow) ? 0 : size - 1);
+                }
+            }
+
+            if(key == utils::keys::BILDUP){
+                row = (row - visible > 0 ? row - visible : 0);
+            }
+
+            if(key == utils::keys::BILDOWN){
+                row = (row + visible < size ? row + visible : size - 1);
+            }
+
+            if(key == utils::keys::POS){
+                row = 0;
+            }
 
-                if(c == settings()->down_key){
-                    row++;
-                    if(row >= (entries.size())){
-                        row = ((settings()->row_selection_overflow) ? 0 : entries.size() - 1);
+            if(key == utils::keys::END){
+                row = size - 1;
+            }
+
+            if(key == utils::keys::ENTER && filtered && size > 0){
+                selection_t.toggle(entryIndex(row));
+                anchor = row;
+            }
+
+            if(key == utils::keys::INS && filtered && size > 0){
+                bool value = selection_t.selected(entryIndex(anchor));
+                if(filter.active()){
+                    int first = (anchor < row ? anchor : row);
+                    int last = (anchor < row ? row : anchor);
+                    for(int i = first; i <= last; i++){
+                        selection_t.set(entryIndex(i), value);
                     }
+                }else{
+                    selection_t.setRange(anchor, row, value);
                 }
+            }
 
-                if(c == haevn::utils::keys::ENTER){
-                    entries.at(row).selected = !entries.at(row).selected;    
+            if(settings()->filter){
+                // CTRL+A, CTRL+D and CTRL+T
+                if(filtered && (key == 'A' - '@' || key == 'D' - '@' || key == 'T' - '@')){
+                    if(!filter.active()){
+                        bulk(key == 'A' - '@', key == 'D' - '@');
+                    }else if(key == 'T' - '@'){
+                        for(const utils::FuzzyMatch& match : filter.matches()){
+                            selection_t.toggle(match.index);
+                        }
+                    }else{
+                        selection_t.setAll(filter.matches(), key == 'A' - '@');
+                    }
                 }
-                if(c == 'q'){
-                    break;
+            }else if(key == settings()->select_all_key || key == settings()->deselect_all_key || key == settings()->invert_key){
+                bulk(key == settings()->select_all_key, key == settings()->deselect_all_key);
+            }
+
+            return (!settings()->filter && key == utils::keys::LOWER_Q);
+        }
+
+        /**
+         * @brief Ends a selection
+         * @return std::vector<std::uint32_t> Ascending indices of the selected entries
+         */
+        std::vector<std::uint32_t> finish(){
+            screen.release();
+            utils::PaintLatency::painted();
+
+            if(update_entries){
+                for(std::size_t i = 0; i < entries->size(); i++){
+                    (*entries)[i].selected = selection_t.selected(i);
                 }
             }
+            return selection_t.indices();
         }
-    private:
-    
-        void inline printEntry(std::string message, int row, int current_row){
-            const char* color = settings()->background;
 
-            if(row == current_row){
-                std::cout << color << settings()->foreground << '[' << (entries.at(row).selected ? "X" : " ") << ']'; 
+        /**
+         * @brief Changes every entry in O(1)
+         * @param select Selects every entry
+         * @param deselect Deselects every entry, otherwise every entry is inverted
+         */
+        void bulk(bool select, bool deselect){
+            if(select){
+                selection_t.selectAll();
+            }else if(deselect){
+                selection_t.clear();
             }else{
-                std::cout << '[' << (entries.at(row).selected ? "X" : " ") << ']';     
+                selection_t.invert();
+            }
+        }
+
+        /**
+         * @brief Draws a frame of the check boxes
+         * @details Adjusts top to keep the selected row visible and visible to the cached terminal size
+         */
+        void draw(){
+            HAEVN_TRACE_SCOPE("checkbox", "draw");
+            screen.begin();
+            screen.line() += utils::dateTime();
+
+            std::string& help = screen.line();
+            if(settings()->filter){
+                help += "Type to filter, use the arrow keys to navigate, <ENTER> to check/uncheck and <ESC> to return";
+            }else{
+                help += "Use ";
+                help += settings()->up_key;
+                help += '/';
+                help += settings()->down_key;
+                help += " to navigate, <ENTER> to check/uncheck, ";
+                help += settings()->select_all_key;
+                help += '/';
+                help += settings()->deselect_all_key;
+                help += '/';
+                help += settings()->invert_key;
+                help += " to check/uncheck/invert all and q to return";
+            }
+
+            screen.line() += message;
+            if(settings()->sub_header.size() > 0){
+                screen.line() += settings()->sub_header;
+            }
+
+            if(settings()->filter){
+                std::string& prompt = screen.line();
+                prompt += "> ";
+                prompt += query;
+                prompt += "  (";
+                prompt += std::to_string(size);
+                prompt += '/';
+                prompt += std::to_string(texts.size());
+                prompt += ')';
+            }else{
+                screen.line();
+            }
+
+            utils::TerminalSize terminal = utils::TerminalGeometry::size(FrameBuffer::standard().fd());
+            // Header lines and the scroll indicator
+            int reserved = (settings()->sub_header.size() > 0 ? 6 : 5);
+            visible = (settings()->visible_rows > 0 ? settings()->visible_rows : terminal.rows - reserved);
+            visible = (visible < 1 ? 1 : visible);
+            if(row < top){
+                top = row;
+            }else if(row >= top + visible){
+                top = row - visible + 1;
+            }
+            if(top + visible > size){
+                top = (size > visible ? size - visible : 0);
             }
 
-            std::cout << message; 
+            int bottom = (top + visible < size ? top + visible : size);
+            if(!filter.active()){
+                texts.prefetch(top, bottom);
+            }
+            for(int i = top; i < bottom; i++){
+                printEntry(screen.line(), entryIndex(i), i, row);
+            }
+
+            if(size > visible){
+                std::string& indicator = screen.line();
+                indicator += (top > 0 ? "^ " : "  ");
+                indicator += std::to_string(top + 1);
+                indicator += '-';
+                indicator += std::to_string(bottom);
+                indicator += " of ";
+                indicator += std::to_string(size);
+                indicator += (bottom < size ? " v" : "  ");
+            }
+
+            utils::PaintLatency::painted(screen.present());
+        }
+
+        /**
+         * @brief Gets the entry which is displayed in a row
+         * @param row Row index, filtered rows are ordered by score
+         * @return int Index of the entry
+         */
+        int entryIndex(int row){
+            return (filter.active() ? filter.matches()[row].index : row);
+        }
+
+        /**
+         * @brief Prints a check box into a screen line
+         * @details Characters which match the filter are highlighted
+         * @param line Line where the entry should be printed
+         * @param index Index of the entry
+         * @param row Row index
+         * @param current_row Current row index
+         */
+        void inline printEntry(std::string& line, int index, int row, int current_row){
+            std::string_view text = texts[index];
+            terminal::colors::StyleTracker style;
+            terminal::colors::Style normal = (row == current_row ? settings()->background | settings()->foreground : terminal::colors::style::DEFAULT);
+
+            style.apply(line, normal);
+            line += '[';
+            line += (selection_t.selected(index) ? 'X' : ' ');
+            line += ']';
+
+            std::int32_t score;
+            const std::string& query = filter.loweredQuery();
+            positions.resize(query.size());
+            if(filter.active() && utils::Fuzzy::match(text, query, score, positions.data())){
+                std::size_t start = 0;
+                // Adjacent matches share one highlight
+                for(std::size_t position : positions){
+                    if(position > start){
+                        style.apply(line, normal);
+                        line.append(text, start, position - start);
+                    }
+                    style.apply(line, normal | settings()->match_highlight);
+                    line += text[position];
+                    start = position + 1;
+                }
+                style.apply(line, normal);
+                line.append(text, start, std::string::npos);
+            }else{
+                line += text;
+            }
 
-            std::cout << haevn::terminal::colors::RESET << std::endl;     
+            style.reset(line);
         }
 
     };
@@ -32,6 +32,8 @@
  */
 #pragma once
 
+#include <cstddef>
+
 namespace haevn::terminal::colors{
 
 #ifdef WIN
@@ -179,4 +181,281 @@ namespace haevn::terminal::colors::icons{
      * @brief This is denied/decline icon with red colorization
      */
     const static char* ICON_DENIED = "\x1B[31m✗\x1B[0m";
-}
\ No newline at end of file
+}
+namespace haevn::terminal::colors{
+
+    /**
+     * @brief This class describes the SGR state of the terminal
+     * @details A style consists of a foreground color, a background color and attributes.
+     *          Styles are constexpr, raw escape sequences like foreground::RED are converted
+     *          implicitly. Use StyleTracker to write them, it only emits what changed.
+     */
+    class Style{
+    public:
+        /**
+         * @brief Bold attribute bit
+         */
+        static constexpr unsigned char BOLD = 1;
+
+        /**
+         * @brief Underline attribute bit
+         */
+        static constexpr unsigned char UNDERLINE = 2;
+
+        /**
+         * @brief SGR code of the foreground color, 0 is the default color
+         */
+        unsigned char foreground = 0;
+
+        /**
+         * @brief SGR code of the background color, 0 is the default color
+         */
+        unsigned char background = 0;
+
+        /**
+         * @brief Attribute bits, see BOLD and UNDERLINE
+         */
+        unsigned char flags = 0;
+
+        /**
+         * @brief Construct the default style
+         */
+        constexpr Style(){}
+
+        /**
+         * @brief Construct a new style
+         * @param foreground_t SGR code of the foreground color, e.g. 31, 0 is the default color
+         * @param background_t SGR code of the background color, e.g. 41, 0 is the default color
+         * @param flags_t Attribute bits
+         */
+        constexpr Style(unsigned char foreground_t, unsigned char background_t, unsigned char flags_t = 0)
+            : foreground(foreground_t), background(background_t), flags(flags_t){}
+
+        /**
+         * @brief Construct a style from escape sequences
+         * @details Parses SGR sequences such as "\x1B[46m\x1B[30m", therefore the raw
+         *          colors of this file can be used wherever a style is expected.
+         * @param sgr Escape sequences, nullptr or "" is the default style
+         */
+        constexpr Style(const char* sgr){
+            while(sgr != nullptr && *sgr != '\0'){
+                if(sgr[0] != '\x1B' || sgr[1] != '['){
+                    sgr++;
+                    continue;
+                }
+                sgr += 2;
+                int code = 0;
+                for(; *sgr != '\0'; sgr++){
+                    if(*sgr >= '0' && *sgr <= '9'){
+                        code = code * 10 + (*sgr - '0');
+                        continue;
+                    }
+                    apply(code);
+                    code = 0;
+                    if(*sgr != ';'){
+                        sgr++;
+                        break;
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief Layers a style above this one
+         * @details Colors of \p other replace the colors of this style unless they are default,
+         *          attributes are combined. E.g. background::CYAN | foreground::BLACK
+         * @param other Style which is layered above
+         * @return Style Combined style
+         */
+        constexpr Style operator|(Style other) const{
+            return Style(other.foreground != 0 ? other.foreground : foreground,
+                         other.background != 0 ? other.background : background,
+                         flags | other.flags);
+        }
+
+        constexpr bool operator==(Style other) const{
+            return foreground == other.foreground && background == other.background && flags == other.flags;
+        }
+
+        constexpr bool operator!=(Style other) const{
+            return !(*this == other);
+        }
+
+    private:
+        constexpr void apply(int code){
+            if(code == 0){
+                foreground = 0;
+                background = 0;
+                flags = 0;
+            }else if(code == 1){
+                flags |= BOLD;
+            }else if(code == 4){
+                flags |= UNDERLINE;
+            }else if(code == 22){
+                flags &= ~BOLD;
+            }else if(code == 24){
+                flags &= ~UNDERLINE;
+            }else if((code >= 30 && code <= 37) || (code >= 90 && code <= 97)){
+                foreground = static_cast<unsigned char>(code);
+            }else if(code == 39){
+                foreground = 0;
+            }else if((code >= 40 && code <= 47) || (code >= 100 && code <= 107)){
+                background = static_cast<unsigned char>(code);
+            }else if(code == 49){
+                background = 0;
+            }
+        }
+    };
+
+    /**
+     * @brief This class tracks the SGR state of an output and emits only changed attributes
+     * @details The tracker assumes the output starts with the default style. Consecutive
+     *          text with the same style costs no escape sequence, a change costs a single
+     *          sequence which is either the difference or a reset followed by the new style,
+     *          whatever is shorter. Call reset() at the end of a line, so the next line
+     *          starts with the default style again.
+     *
+     * Example
+     * +--------------------------------------------------------------------+
+     * |  std::string line;                                                 |
+     * |  haevn::terminal::colors::StyleTracker tracker;                    |
+     * |  tracker.apply(line, colors::style::foreground::RED);              |
+     * |  line += "error";                                                  |
+     * |  tracker.reset(line);                                              |
+     * +--------------------------------------------------------------------+
+     */
+    class StyleTracker{
+    private:
+        Style current;
+
+    public:
+        /**
+         * @brief Gets the style of the output
+         */
+        Style style() const{
+            return current;
+        }
+
+        /**
+         * @brief Emits the escape sequence which changes the style of the output
+         * @tparam Output std::string or FrameBuffer
+         * @param output Output where the sequence is appended, nothing is appended if the style is unchanged
+         * @param next Style of the following text
+         */
+        template<typename Output>
+        void apply(Output& output, Style next){
+            if(next == current){
+                return;
+            }
+
+            char difference[32];
+            std::size_t difference_length = 0;
+            if((current.flags & ~next.flags & Style::BOLD) != 0){
+                append(difference, difference_length, 22);
+            }
+            if((current.flags & ~next.flags & Style::UNDERLINE) != 0){
+                append(difference, difference_length, 24);
+            }
+            if((next.flags & ~current.flags & Style::BOLD) != 0){
+                append(difference, difference_length, 1);
+            }
+            if((next.flags & ~current.flags & Style::UNDERLINE) != 0){
+                append(difference, difference_length, 4);
+            }
+            if(next.foreground != current.foreground){
+                append(difference, difference_length, next.foreground != 0 ? next.foreground : 39);
+            }
+            if(next.background != current.background){
+                append(difference, difference_length, next.background != 0 ? next.background : 49);
+            }
+
+            char full[32];
+            std::size_t full_length = 0;
+            append(full, full_length, 0);
+            if((next.flags & Style::BOLD) != 0){
+                append(full, full_length, 1);
+            }
+            if((next.flags & Style::UNDERLINE) != 0){
+                append(full, full_length, 4);
+            }
+            if(next.foreground != 0){
+                append(full, full_length, next.foreground);
+            }
+            if(next.background != 0){
+                append(full, full_length, next.background);
+            }
+
+            bool shorter = (full_length < difference_length);
+            output.append("\x1B[", 2);
+            output.append(shorter ? full : difference, shorter ? full_length : difference_length);
+            output.append("m", 1);
+            current = next;
+        }
+
+        /**
+         * @brief Emits the escape sequence which restores the default style if required
+         * @tparam Output std::string or FrameBuffer
+         * @param output Output where the sequence is appended
+         */
+        template<typename Output>
+        void reset(Output& output){
+            apply(output, Style());
+        }
+
+    private:
+        /**
+         * @brief Appends a parameter to a parameter list
+         */
+        static void append(char* parameters, std::size_t& length, int code){
+            if(length > 0){
+                parameters[length++] = ';';
+            }
+            if(code >= 100){
+                parameters[length++] = static_cast<char>('0' + code / 100);
+            }
+            if(code >= 10){
+                parameters[length++] = static_cast<char>('0' + code / 10 % 10);
+            }
+            parameters[length++] = static_cast<char>('0' + code % 10);
+        }
+    };
+}
+
+namespace haevn::terminal::colors::style{
+
+    /**
+     * @brief Default colors without attributes
+     */
+    constexpr Style DEFAULT;
+}
+
+namespace haevn::terminal::colors::style::foreground{
+
+    constexpr Style BLACK(30, 0);
+    constexpr Style RED(31, 0);
+    constexpr Style GREEN(32, 0);
+    constexpr Style YELLOW(33, 0);
+    constexpr Style BLUE(34, 0);
+    constexpr Style MAGENTA(35, 0);
+    constexpr Style CYAN(36, 0);
+    constexpr Style WHITE(37, 0);
+}
+
+namespace haevn::terminal::colors::style::font{
+
+    constexpr Style BOLD(0, 0, Style::BOLD);
+    constexpr Style UNDERLINE(0, 0, Style::UNDERLINE);
+}
+
+namespace haevn::terminal::colors::style::background{
+
+    constexpr Style TRANSPARENT;
+    constexpr Style BLACK(0, 40);
+    constexpr Style RED(0, 41);
+    constexpr Style GREEN(0, 42);
+    constexpr Style YELLOW(0, 43);
+    constexpr Style BLUE(0, 44);
+    constexpr Style MAGENTA(0, 45);
+    constexpr Style CYAN(0, 46);
+    constexpr Style WHITE(0, 47);
+}
@@ -0,0 +1,278 @@
+/**
+ * @file This file contains a progressbar which can be updated from many threads
+ * @details This file is licensed under the MIT license. If you decide to use this
+ *          file a copy of the following license must be provided. Giving credit in
+ *          form of a mention inside your source code, documentation or the final
+ *          product would be nice but is not required.
+ *
+ * Example
+ * +--------------------------------------------------------+
+ * |  haevn::terminal::widgets::ConcurrentProgressBar bar;  |
+ * |  bar.settings()->maximum = jobs.size();                |
+ * |  bar.start();                                          |
+ * |  // From any worker thread                             |
+ * |  bar.update();                                         |
+ * |  // Once all workers are done                          |
+ * |  bar.finish();                                         |
+ * +--------------------------------------------------------+
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Nils Milewski (haevn)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+ * @author Nils Milewski
+ * @version 1.0.0.0
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "progressbar.hpp"
+#include "reactor.hpp"
+
+namespace haevn::terminal::widgets{
+
+/**
+ * @brief This class contains a progressbar for many threads
+ * @details Any number of threads can call update concurrently. Every thread increments its
+ *          own cache line aligned counter with a relaxed atomic add, so the hot path has
+ *          neither a mutex nor contention on a shared cache line. A single render thread
+ *          samples the sum of all counters with the frame rate of the settings and draws
+ *          it with a ProgressBar. The render thread writes through a frame buffer of its own
+ *          on the descriptor of FrameBuffer::standard(), so output of other threads is not
+ *          corrupted, but it may interleave with the frames while the progressbar runs.
+ * @author Nils Milewski
+ * @version 1.0
+ */
+class ConcurrentProgressBar{
+private:
+
+    /**
+     * @brief Amount of counters, must be a power of two
+     */
+    static constexpr std::size_t shard_count = 64;
+
+    /**
+     * @brief Counter which lives on its own cache line
+     */
+    struct alignas(64) Shard{
+        std::atomic<std::uint64_t> value{0};
+    };
+
+    std::array<Shard, shard_count> shards;
+
+    /**
+     * @brief Progressbar which is drawn by the render thread
+     */
+    ProgressBar bar;
+
+    /**
+     * @brief Frame buffer of the progressbar, the standard one belongs to the caller thread
+     */
+    FrameBuffer output;
+
+    std::thread renderer;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+
+    /**
+     * @brief Reactor whose timer draws the progressbar, nullptr if none is used
+     */
+    utils::Reactor* reactor = nullptr;
+    std::uint64_t timer = 0;
+
+public:
+    ConcurrentProgressBar(){
+        bar.output(output);
+    }
+
+    ~ConcurrentProgressBar(){
+        stop();
+    }
+
+    ConcurrentProgressBar(const ConcurrentProgressBar&) = delete;
+    ConcurrentProgressBar& operator=(const ConcurrentProgressBar&) = delete;
+
+    /**
+     * @brief Gets the settings
+     * @details Settings should only be changed before start is called
+     * @return ProgressbarSettings* Settings of the drawn progressbar
+     */
+    ProgressbarSettings* settings(){
+        return bar.settings();
+    }
+
+    /**
+     * @brief Starts the render thread
+     */
+    void start(){
+        std::lock_guard<std::mutex> lock(mutex);
+        if(renderer.joinable()){
+            return;
+        }
+        stopping = false;
+        output.fd(FrameBuffer::standard().fd());
+        renderer = std::thread(&ConcurrentProgressBar::run, this);
+    }
+
+    /**
+     * @brief Draws the progressbar with a timer of a reactor instead of a render thread
+     * @details The counters are sampled on the thread of the reactor with the frame rate of
+     *          the settings. finish, cancel and abort must be called on the thread of the reactor.
+     * @param reactor_t Reactor which draws the progressbar, must outlive the drawing
+     */
+    void start(utils::Reactor& reactor_t){
+        std::lock_guard<std::mutex> lock(mutex);
+        if(renderer.joinable() || reactor != nullptr){
+            return;
+        }
+        stopping = false;
+        output.fd(FrameBuffer::standard().fd());
+        unsigned int fps = settings()->frames_per_second;
+        reactor = &reactor_t;
+        timer = reactor->every(1000 / (fps > 0 && fps < 1000 ? fps : 100), [this]{
+            bar.value(clamped());
+        });
+    }
+
+    /**
+     * @brief updates the value
+     * @details Can be called from any thread, costs one relaxed atomic add
+     * @param step Step to increment, default 1
+     */
+    void update(std::uint64_t step = 1){
+        shards[shardIndex()].value.fetch_add(step, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Gets the current value
+     * @details Sums all counters, concurrent updates may or may not be included
+     * @return std::uint64_t Current value
+     */
+    std::uint64_t value() const{
+        std::uint64_t sum = 0;
+        for(const Shard& shard : shards){
+            sum += shard.value.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+    /**
+     * @brief Finishes the progressbar
+     * @details Stops the render thread and draws the final state in green
+     */
+    void finish(){
+        stop();
+        bar.value(clamped());
+        bar.finish();
+    }
+
+    /**
+     * @brief Cancels the progressbar
+     * @details Stops the render thread and draws the final state in yellow
+     */
+    void cancel(){
+        stop();
+        bar.value(clamped());
+        bar.cancel();
+    }
+
+    /**
+     * @brief Aborts the progressbar
+     * @details Stops the render thread and draws the final state in red
+     */
+    void abort(){
+        stop();
+        bar.value(clamped());
+        bar.abort();
+    }
+
+private:
+
+    /**
+     * @brief Gets the counter index of the calling thread
+     * @return std::size_t Index which is assigned round robin on the first call of a thread
+     */
+    static std::size_t shardIndex(){
+        static std::atomic<std::size_t> next{0};
+        thread_local std::size_t index = next.fetch_add(1, std::memory_order_relaxed) & (shard_count - 1);
+        return index;
+    }
+
+    /**
+     * @brief Gets the current value limited to the maximum of the progressbar
+     * @return int Current value
+     */
+    int clamped(){
+        std::uint64_t current = value();
+        std::uint64_t maximum = settings()->maximum;
+        return static_cast<int>(current < maximum ? current : maximum);
+    }
+
+    /**
+     * @brief Stops the render thread
+     */
+    void stop(){
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        condition.notify_all();
+        if(renderer.joinable()){
+            renderer.join();
+        }
+        if(reactor != nullptr){
+            reactor->cancel(timer);
+            reactor = nullptr;
+        }
+    }
+
+    /**
+     * @brief Render thread
+     * @details Samples the counters until stop is called. Once the maximum is reached the
+     *          full bar is drawn and the thread sleeps, the final state is drawn by
+     *          finish, cancel or abort of the caller.
+     */
+    void run(){
+        unsigned int fps = settings()->frames_per_second;
+        auto interval = std::chrono::nanoseconds(std::chrono::seconds(1)) / (fps > 0 ? fps : 100);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while(!stopping){
+            bar.value(clamped());
+            if(value() >= settings()->maximum){
+                condition.wait(lock, [this]{ return stopping; });
+                return;
+            }
+            condition.wait_for(lock, interval);
+        }
+    }
+};
+
+} // ns: haevn::terminal::widgets
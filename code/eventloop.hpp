@@ -0,0 +1,747 @@
+/**
+ * @file This file contains a coroutine task type and an event loop built on the Reactor
+ * @details This file is licensed under the MIT license. If you decide to use this
+ *          file a copy of the following license must be provided. Giving credit in
+ *          form of a mention inside your source code, documentation or the final
+ *          product would be nice but is not required.
+ *          The coroutine API requires C++20. With older standards HAEVN_COROUTINES is not
+ *          defined, the ...Async methods of the widgets do not exist and using EventLoop
+ *          or Task fails with a static assertion which names the required standard.
+ *
+ * Example
+ * +--------------------------------------------------------------------+
+ * |  haevn::utils::EventLoop loop;                                     |
+ * |  loop.spawn(download(loop));           // Task<void> of the caller |
+ * |  int row = loop.run(menu.getSelectionAsync(loop));                 |
+ * |                                                                    |
+ * |  haevn::utils::Task<void> download(haevn::utils::EventLoop& loop){ |
+ * |      while(co_await loop.readable(socket)){                        |
+ * |          provider.append(receive(socket));                         |
+ * |      }                                                             |
+ * |  }                                                                 |
+ * +--------------------------------------------------------------------+
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Nils Milewski (haevn)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+ * @author Nils Milewski
+ * @version 1.0.0.0
+ */
+#pragma once
+
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+
+#define HAEVN_COROUTINES 1
+
+#include <algorithm>
+#include <coroutine>
+#include <deque>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "utils.hpp"
+#include "keyboard.hpp"
+#include "reactor.hpp"
+
+namespace haevn::utils{
+
+    template<typename T = void>
+    class Task;
+
+    /**
+     * @brief Parts of the task promise which do not depend on the result type
+     */
+    class TaskPromiseBase{
+    public:
+        /**
+         * @brief Coroutine which awaits the task, resumed once the task finished
+         */
+        std::coroutine_handle<> continuation;
+        std::exception_ptr exception;
+
+        /**
+         * @brief Tasks are lazy, they start once they are awaited or spawned
+         */
+        std::suspend_always initial_suspend() noexcept{
+            return {};
+        }
+
+        struct FinalAwaiter{
+            bool await_ready() noexcept{
+                return false;
+            }
+
+            template<typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept{
+                std::coroutine_handle<> next = handle.promise().continuation;
+                return (next ? next : std::noop_coroutine());
+            }
+
+            void await_resume() noexcept{}
+        };
+
+        FinalAwaiter final_suspend() noexcept{
+            return {};
+        }
+
+        void unhandled_exception(){
+            exception = std::current_exception();
+        }
+    };
+
+    template<typename T>
+    class TaskPromise : public TaskPromiseBase{
+    public:
+        std::optional<T> value;
+
+        Task<T> get_return_object();
+
+        template<typename U>
+        void return_value(U&& result){
+            value.emplace(std::forward<U>(result));
+        }
+
+        T result(){
+            if(exception){
+                std::rethrow_exception(exception);
+            }
+            return std::move(*value);
+        }
+    };
+
+    template<>
+    class TaskPromise<void> : public TaskPromiseBase{
+    public:
+        Task<void> get_return_object();
+
+        void return_void(){}
+
+        void result(){
+            if(exception){
+                std::rethrow_exception(exception);
+            }
+        }
+    };
+
+    /**
+     * @brief This class contains a lazily started coroutine with a result
+     * @details A task starts once it is awaited by another coroutine or spawned on an
+     *          EventLoop. Awaiting a finished task returns its result or rethrows its exception.
+     * @tparam T Type of the result
+     */
+    template<typename T>
+    class Task{
+    public:
+        using promise_type = TaskPromise<T>;
+
+    private:
+        std::coroutine_handle<promise_type> handle;
+
+    public:
+        explicit Task(std::coroutine_handle<promise_type> handle_t) : handle(handle_t){}
+
+        Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)){}
+
+        Task& operator=(Task&& other) noexcept{
+            if(this != &other){
+                if(handle){
+                    handle.destroy();
+                }
+                handle = std::exchange(other.handle, nullptr);
+            }
+            return *this;
+        }
+
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+
+        ~Task(){
+            if(handle){
+                handle.destroy();
+            }
+        }
+
+        /**
+         * @brief Indicates that the task finished
+         */
+        bool done() const{
+            return !handle || handle.done();
+        }
+
+        bool await_ready() const{
+            return done();
+        }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting){
+            handle.promise().continuation = awaiting;
+            return handle;
+        }
+
+        T await_resume(){
+            return handle.promise().result();
+        }
+    };
+
+    template<typename T>
+    Task<T> TaskPromise<T>::get_return_object(){
+        return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+    }
+
+    inline Task<void> TaskPromise<void>::get_return_object(){
+        return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+    }
+
+    /**
+     * @brief This class contains a single threaded event loop for coroutines
+     * @details Coroutines suspend on file descriptors, timers or terminal keys and the loop
+     *          resumes them once the Reactor reports the descriptor or the timer expired.
+     *          Timeouts live on the timer wheel of the reactor, callbacks which are registered
+     *          on reactor(), e.g. every() or onResize(), run on the same thread.
+     *          Widgets draw fullscreen through FrameBuffer::standard(), therefore one widget
+     *          owns the terminal at a time: the ...Async methods await terminal() first, a
+     *          widget which is awaited while another one runs starts once the first finished.
+     *          Keys are delivered to the owner of the terminal. Background tasks keep running
+     *          meanwhile, tasks which draw, e.g. progress bars, should own the terminal too.
+     */
+    class EventLoop{
+    private:
+        /**
+         * @brief A coroutine waiting for a descriptor and/or a timeout
+         */
+        struct Waiter{
+            int fd;
+            std::uint32_t events;
+            int timeout_ms;
+            std::coroutine_handle<> handle;
+            /**
+             * @brief Timer of the reactor, 0 if none is scheduled
+             */
+            std::uint64_t timer = 0;
+            bool ready = false;
+        };
+
+        /**
+         * @brief Waiters of a descriptor and the events it is watched for
+         */
+        struct Watch{
+            std::vector<Waiter*> waiters;
+            std::uint32_t events = 0;
+        };
+
+        /**
+         * @brief Coroutine which owns a spawned task and destroys itself afterwards
+         */
+        struct Detached{
+            struct promise_type{
+                Detached get_return_object(){
+                    return Detached{std::coroutine_handle<promise_type>::from_promise(*this)};
+                }
+
+                std::suspend_always initial_suspend() noexcept{
+                    return {};
+                }
+
+                std::suspend_never final_suspend() noexcept{
+                    return {};
+                }
+
+                void return_void(){}
+
+                void unhandled_exception(){
+                    std::terminate();
+                }
+            };
+
+            std::coroutine_handle<promise_type> handle;
+        };
+
+        Reactor reactor_t;
+        std::vector<std::coroutine_handle<>> ready;
+
+        /**
+         * @brief Indicates that a coroutine owns the terminal
+         */
+        bool terminal_owned = false;
+
+        /**
+         * @brief Coroutines waiting for the terminal in the order they asked for it
+         */
+        std::deque<std::coroutine_handle<>> terminal_queue;
+        std::unordered_map<int, Watch> watched;
+
+        /**
+         * @brief Waiters with a timeout of 0, they are woken after one check of the descriptors
+         */
+        std::vector<Waiter*> polling;
+
+        /**
+         * @brief Amount of suspended waiters
+         */
+        std::size_t waiting = 0;
+        std::size_t active = 0;
+
+    public:
+
+        /**
+         * @brief Awaitable which suspends until a descriptor is ready or a timeout passed
+         */
+        class WaitAwaiter{
+        private:
+            EventLoop& loop;
+            Waiter waiter;
+
+        public:
+            WaitAwaiter(EventLoop& loop_t, int fd, std::uint32_t events, int timeout_ms) : loop(loop_t){
+                waiter.fd = fd;
+                waiter.events = events;
+                waiter.timeout_ms = timeout_ms;
+            }
+
+            bool await_ready() const{
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle){
+                waiter.handle = handle;
+                loop.suspend(&waiter);
+            }
+
+            /**
+             * @return true If the descriptor is ready, false on timeout
+             */
+            bool await_resume() const{
+                return waiter.ready;
+            }
+        };
+
+        /**
+         * @brief Ownership of the terminal, released once it is destroyed
+         * @details Keys of the terminal should be read through key() of the owner
+         */
+        class Terminal{
+        private:
+            EventLoop* loop;
+
+        public:
+            explicit Terminal(EventLoop& loop_t) : loop(&loop_t){}
+
+            Terminal(Terminal&& other) noexcept : loop(std::exchange(other.loop, nullptr)){}
+
+            Terminal(const Terminal&) = delete;
+            Terminal& operator=(const Terminal&) = delete;
+            Terminal& operator=(Terminal&&) = delete;
+
+            ~Terminal(){
+                if(loop != nullptr){
+                    loop->releaseTerminal();
+                }
+            }
+
+            /**
+             * @brief Reads and decodes one key without blocking the loop
+             * @param session Session which provides the input
+             * @param timeout_ms Timeout for the first byte in milliseconds, negative values wait forever
+             * @return Task<keys> Key which was read or NONE if nothing arrived in time
+             */
+            Task<keys> key(TerminalSession& session, int timeout_ms = -1){
+                return loop->readKey(session, timeout_ms);
+            }
+        };
+
+        /**
+         * @brief Awaitable which suspends until the terminal is free
+         */
+        class TerminalAwaiter{
+        private:
+            EventLoop& loop;
+
+        public:
+            explicit TerminalAwaiter(EventLoop& loop_t) : loop(loop_t){}
+
+            bool await_ready() const{
+                if(loop.terminal_owned){
+                    return false;
+                }
+                loop.terminal_owned = true;
+                return true;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle){
+                loop.terminal_queue.push_back(handle);
+            }
+
+            /**
+             * @return Terminal Ownership, handed over by the previous owner
+             */
+            Terminal await_resume() const{
+                return Terminal(loop);
+            }
+        };
+
+        /**
+         * @brief Awaitable which reschedules the coroutine behind the ready ones
+         */
+        class YieldAwaiter{
+        private:
+            EventLoop& loop;
+
+        public:
+            explicit YieldAwaiter(EventLoop& loop_t) : loop(loop_t){}
+
+            bool await_ready() const{
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle){
+                loop.ready.push_back(handle);
+            }
+
+            void await_resume() const{}
+        };
+
+        EventLoop(){}
+        EventLoop(const EventLoop&) = delete;
+        EventLoop& operator=(const EventLoop&) = delete;
+
+        /**
+         * @brief Starts a task which runs detached on the loop
+         * @details The task starts on the next step of the loop. Exceptions of detached tasks
+         *          terminate the program.
+         * @param task Task which should run
+         */
+        void spawn(Task<void> task){
+            active++;
+            ready.push_back(detach(*this, std::move(task)).handle);
+        }
+
+        /**
+         * @brief Runs the loop until a task finished
+         * @details Spawned tasks keep running while the loop runs
+         * @param task Task whose result is needed
+         * @return T Result of the task, its exception is rethrown
+         * @throws std::logic_error If the task waits for something the loop can not deliver,
+         *         e.g. a terminal which is never released
+         */
+        template<typename T>
+        T run(Task<T> task){
+            bool done = false;
+            std::exception_ptr exception;
+            if constexpr(std::is_void_v<T>){
+                spawn(store(std::move(task), nullptr, &done, &exception));
+                finish(done, exception);
+            }else{
+                std::optional<T> result;
+                spawn(store(std::move(task), &result, &done, &exception));
+                finish(done, exception);
+                return std::move(*result);
+            }
+        }
+
+        /**
+         * @brief Runs the loop until every spawned task finished
+         */
+        void run(){
+            while(active > 0 && step()){}
+        }
+
+        /**
+         * @brief Gets the reactor which drives the loop
+         * @details Descriptors which are awaited through the loop must not be watched directly
+         */
+        Reactor& reactor(){
+            return reactor_t;
+        }
+
+        /**
+         * @brief Executes ready coroutines or waits once for descriptors and timers
+         * @return false If nothing is ready or waiting
+         */
+        bool step(){
+            if(!ready.empty()){
+                std::vector<std::coroutine_handle<>> batch;
+                batch.swap(ready);
+                for(std::coroutine_handle<> handle : batch){
+                    handle.resume();
+                }
+                return true;
+            }
+            if(waiting == 0){
+                return false;
+            }
+
+            // Descriptors stay watched while their coroutine runs, most of them await again
+            for(auto it = watched.begin(); it != watched.end();){
+                if(it->second.waiters.empty()){
+                    reactor_t.unwatch(it->first);
+                    it = watched.erase(it);
+                }else{
+                    ++it;
+                }
+            }
+            if(!reactor_t.runOnce(polling.empty() ? -1 : 0)){
+                return false;
+            }
+            std::vector<Waiter*> expired;
+            expired.swap(polling);
+            for(Waiter* waiter : expired){
+                if(waiter->handle){
+                    wake(waiter, false);
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @brief Suspends until a descriptor is readable
+         * @param fd File descriptor
+         * @param timeout_ms Timeout in milliseconds, negative values wait forever
+         * @return WaitAwaiter Awaitable returning false on timeout
+         */
+        WaitAwaiter readable(int fd, int timeout_ms = -1){
+            return WaitAwaiter(*this, fd, EPOLLIN, timeout_ms);
+        }
+
+        /**
+         * @brief Suspends until a descriptor is writable
+         * @param fd File descriptor
+         * @param timeout_ms Timeout in milliseconds, negative values wait forever
+         * @return WaitAwaiter Awaitable returning false on timeout
+         */
+        WaitAwaiter writable(int fd, int timeout_ms = -1){
+            return WaitAwaiter(*this, fd, EPOLLOUT, timeout_ms);
+        }
+
+        /**
+         * @brief Suspends for a duration
+         * @param milliseconds Duration in milliseconds
+         */
+        WaitAwaiter sleep(int milliseconds){
+            return WaitAwaiter(*this, -1, 0, (milliseconds > 0 ? milliseconds : 0));
+        }
+
+        /**
+         * @brief Lets other ready coroutines run
+         */
+        YieldAwaiter yield(){
+            return YieldAwaiter(*this);
+        }
+
+        /**
+         * @brief Suspends until the coroutine owns the terminal
+         * @details The terminal is handed over in the order it was asked for
+         * @return TerminalAwaiter Awaitable returning the Terminal ownership
+         */
+        TerminalAwaiter terminal(){
+            return TerminalAwaiter(*this);
+        }
+
+        /**
+         * @brief Reads and decodes one key without blocking the loop
+         * @details Asynchronous counterpart of KeyDecoder::read. The terminal is owned while
+         *          the key is read, so keys of a running widget are never taken, the timeout
+         *          starts once the terminal is free. Owners read through Terminal::key.
+         * @param session Session which provides the input
+         * @param timeout_ms Timeout for the first byte in milliseconds, negative values wait forever
+         * @return Task<keys> Key which was read or NONE if nothing arrived in time
+         */
+        Task<keys> key(TerminalSession& session, int timeout_ms = -1){
+            Terminal owner = co_await terminal();
+            co_return co_await readKey(session, timeout_ms);
+        }
+
+    private:
+
+        /**
+         * @brief Hands the terminal to the next waiting coroutine
+         */
+        void releaseTerminal(){
+            if(terminal_queue.empty()){
+                terminal_owned = false;
+                return;
+            }
+            ready.push_back(terminal_queue.front());
+            terminal_queue.pop_front();
+        }
+
+        /**
+         * @brief Runs the loop until a task of run() is done
+         */
+        void finish(bool& done, std::exception_ptr& exception){
+            while(!done && step()){}
+            if(exception){
+                std::rethrow_exception(exception);
+            }
+            if(!done){
+                throw std::logic_error("EventLoop::run: the task waits for nothing the loop can deliver");
+            }
+        }
+
+        /**
+         * @brief Reads and decodes one key, the caller owns the terminal
+         */
+        Task<keys> readKey(TerminalSession& session, int timeout_ms){
+            KeyDecoder decoder;
+            keys key = NONE;
+            if(session.buffered() == 0 && !co_await readable(session.fd(), timeout_ms)){
+                co_return NONE;
+            }
+            int c = session.get();
+            if(c == EOF){
+                co_return NONE;
+            }
+            while(!decoder.feed(c, key)){
+                if(session.buffered() == 0 && !co_await readable(session.fd(), KeyDecoder::escape_timeout)){
+                    co_return decoder.flush();
+                }
+                c = session.get();
+                if(c == EOF){
+                    co_return decoder.flush();
+                }
+            }
+            co_return key;
+        }
+
+        /**
+         * @brief Registers a suspended waiter with the reactor
+         */
+        void suspend(Waiter* waiter){
+            waiting++;
+            if(waiter->fd >= 0){
+                Watch& watch = watched[waiter->fd];
+                watch.waiters.push_back(waiter);
+                std::uint32_t events = watch.events | waiter->events;
+                if(events != watch.events){
+                    int fd = waiter->fd;
+                    if(!reactor_t.watch(fd, events, [this, fd](std::uint32_t occurred){ dispatch(fd, occurred); })){
+                        // E.g. regular files, they are always ready
+                        wake(waiter, true);
+                        return;
+                    }
+                    watch.events = events;
+                }
+            }
+            if(waiter->timeout_ms == 0){
+                polling.push_back(waiter);
+            }else if(waiter->timeout_ms > 0){
+                waiter->timer = reactor_t.after(waiter->timeout_ms, [this, waiter]{
+                    waiter->timer = 0;
+                    wake(waiter, false);
+                });
+            }
+        }
+
+        /**
+         * @brief Wakes the waiters of a descriptor which are interested in the events
+         */
+        void dispatch(int fd, std::uint32_t occurred){
+            auto found = watched.find(fd);
+            if(found == watched.end()){
+                return;
+            }
+            std::vector<Waiter*> waiters = found->second.waiters;
+            for(Waiter* waiter : waiters){
+                if((occurred & (waiter->events | EPOLLHUP | EPOLLERR)) != 0){
+                    wake(waiter, true);
+                }
+            }
+        }
+
+        /**
+         * @brief Removes a waiter from the reactor and schedules its coroutine
+         * @param waiter Suspended waiter
+         * @param result true if the descriptor is ready, false on timeout
+         */
+        void wake(Waiter* waiter, bool result){
+            if(waiter->fd >= 0){
+                std::vector<Waiter*>& waiters = watched[waiter->fd].waiters;
+                waiters.erase(std::find(waiters.begin(), waiters.end(), waiter));
+            }
+            if(waiter->timer != 0){
+                reactor_t.cancel(waiter->timer);
+                waiter->timer = 0;
+            }
+            waiter->ready = result;
+            ready.push_back(waiter->handle);
+            // Marks the waiter as woken for polling
+            waiter->handle = nullptr;
+            waiting--;
+        }
+
+        static Detached detach(EventLoop& loop, Task<void> task){
+            co_await task;
+            loop.active--;
+        }
+
+        /**
+         * @brief Awaits a task and stores its result for run()
+         * @param result std::optional<T> which receives the result, unused for void tasks
+         */
+        template<typename T>
+        static Task<void> store(Task<T> task, void* result, bool* done, std::exception_ptr* exception){
+            try{
+                if constexpr(std::is_void_v<T>){
+                    co_await task;
+                }else{
+                    static_cast<std::optional<T>*>(result)->emplace(co_await task);
+                }
+            }catch(...){
+                *exception = std::current_exception();
+            }
+            *done = true;
+        }
+    };
+}
+
+#else
+
+#include <type_traits>
+
+namespace haevn::utils{
+
+    /**
+     * @brief Fails the compilation once the event loop is used without coroutines
+     */
+    template<typename T>
+    struct CoroutinesRequired : std::false_type{};
+
+    template<typename T = void>
+    class Task{
+        static_assert(CoroutinesRequired<T>::value, "haevn::utils::Task requires C++20 coroutines, compile with -std=c++20");
+    };
+
+    class EventLoop{
+    public:
+        template<typename T = void>
+        EventLoop(){
+            static_assert(CoroutinesRequired<T>::value, "haevn::utils::EventLoop requires C++20 coroutines, compile with -std=c++20");
+        }
+    };
+}
+
+#endif
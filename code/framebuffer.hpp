@@ -0,0 +1,259 @@
+/**
+ * @file This file contains a frame buffer which writes widget output with a single syscall
+ * @details This file is licensed under the MIT license. If you decide to use this
+ *          file a copy of the following license must be provided. Giving credit in
+ *          form of a mention inside your source code, documentation or the final
+ *          product would be nice but is not required.
+ *
+ * Example
+ * +---------------------------------------------------------------------------------+
+ * |  haevn::terminal::FrameBuffer& out = haevn::terminal::FrameBuffer::standard();  |
+ * |  out += haevn::terminal::colors::foreground::GREEN;                             |
+ * |  out += "Done";                                                                 |
+ * |  out += haevn::terminal::colors::RESET;                                         |
+ * |  out.flush();                                                                   |
+ * +---------------------------------------------------------------------------------+
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Nils Milewski (haevn)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+ * @author Nils Milewski
+ * @version 1.0.0.0
+ */
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+extern "C"{
+    #include <poll.h>
+    #include <unistd.h>
+}
+
+#include "trace.hpp"
+
+namespace haevn::terminal{
+
+    /**
+     * @brief This structure contains the statistics of a frame buffer
+     */
+    struct FrameStatistics{
+        /**
+         * @brief Amount of flushed frames
+         */
+        std::uint64_t frames = 0;
+
+        /**
+         * @brief Amount of written bytes
+         */
+        std::uint64_t bytes = 0;
+
+        /**
+         * @brief Amount of write syscalls
+         */
+        std::uint64_t syscalls = 0;
+
+        /**
+         * @brief Size of the last frame in bytes
+         */
+        std::size_t last_frame_bytes = 0;
+
+        /**
+         * @brief Amount of write syscalls of the last frame
+         */
+        std::size_t last_frame_syscalls = 0;
+    };
+
+    /**
+     * @brief This class contains a frame buffer
+     * @details Widgets append text and escape sequences of a whole frame into a preallocated
+     *          buffer which is written with a single write(2) on flush, instead of streaming
+     *          many small pieces through std::cout. The buffer keeps its capacity between frames.
+     *          A frame buffer is not thread safe.
+     */
+    class FrameBuffer{
+    private:
+        std::string buffer;
+        int descriptor;
+        FrameStatistics statistics_t;
+
+    public:
+        /**
+         * @brief Construct a new frame buffer
+         * @param fd File descriptor where frames are written, default stdout
+         * @param capacity Initial capacity in bytes
+         */
+        explicit FrameBuffer(int fd = STDOUT_FILENO, std::size_t capacity = 16384) : descriptor(fd){
+            buffer.reserve(capacity);
+        }
+
+        /**
+         * @brief Gets the frame buffer which is used by the widgets
+         * @details Writes to stdout unless redirected with fd(int)
+         * @return FrameBuffer& Shared frame buffer
+         */
+        static FrameBuffer& standard(){
+            static FrameBuffer instance;
+            return instance;
+        }
+
+        /**
+         * @brief Gets the file descriptor where frames are written
+         */
+        int fd() const{
+            return descriptor;
+        }
+
+        /**
+         * @brief Sets the file descriptor where frames are written
+         * @param fd New file descriptor, e.g. a tty or a file
+         */
+        void fd(int fd){
+            descriptor = fd;
+        }
+
+        FrameBuffer& operator+=(char c){
+            buffer += c;
+            return *this;
+        }
+
+        FrameBuffer& operator+=(const char* text){
+            buffer += text;
+            return *this;
+        }
+
+        FrameBuffer& operator+=(std::string_view text){
+            buffer += text;
+            return *this;
+        }
+
+        FrameBuffer& operator+=(const std::string& text){
+            buffer += text;
+            return *this;
+        }
+
+        /**
+         * @brief Appends \p count copies of \p c
+         */
+        FrameBuffer& append(std::size_t count, char c){
+            buffer.append(count, c);
+            return *this;
+        }
+
+        /**
+         * @brief Appends text
+         */
+        FrameBuffer& append(const char* text, std::size_t length){
+            buffer.append(text, length);
+            return *this;
+        }
+
+        /**
+         * @brief Gets the amount of buffered bytes
+         */
+        std::size_t size() const{
+            return buffer.size();
+        }
+
+        /**
+         * @brief Indicates that nothing is buffered
+         */
+        bool empty() const{
+            return buffer.empty();
+        }
+
+        /**
+         * @brief Discards the buffered bytes
+         */
+        void clear(){
+            buffer.clear();
+        }
+
+        /**
+         * @brief Gets the statistics of all flushed frames
+         */
+        const FrameStatistics& statistics() const{
+            return statistics_t;
+        }
+
+        /**
+         * @brief Resets the statistics
+         */
+        void resetStatistics(){
+            statistics_t = FrameStatistics();
+        }
+
+        /**
+         * @brief Writes the buffered frame
+         * @details Pending std::cout/stdout output is flushed first when writing to stdout,
+         *          so the order of the output is kept. Partial writes are continued, usually
+         *          the frame is written with a single syscall.
+         * @return true If the whole frame was written
+         */
+        bool flush(){
+            HAEVN_TRACE_SCOPE("framebuffer", "write");
+            if(buffer.empty()){
+                return true;
+            }
+            if(descriptor == STDOUT_FILENO){
+                std::cout.flush();
+                std::fflush(stdout);
+            }
+
+            const char* data = buffer.data();
+            std::size_t left = buffer.size();
+            std::size_t syscalls = 0;
+            bool result = true;
+            while(left > 0){
+                ssize_t written = ::write(descriptor, data, left);
+                syscalls++;
+                if(written < 0){
+                    if(errno == EINTR){
+                        continue;
+                    }
+                    if(errno == EAGAIN || errno == EWOULDBLOCK){
+                        struct pollfd descriptor_t = {descriptor, POLLOUT, 0};
+                        poll(&descriptor_t, 1, -1);
+                        continue;
+                    }
+                    result = false;
+                    break;
+                }
+                data += written;
+                left -= written;
+            }
+
+            statistics_t.frames++;
+            statistics_t.bytes += buffer.size() - left;
+            statistics_t.syscalls += syscalls;
+            statistics_t.last_frame_bytes = buffer.size() - left;
+            statistics_t.last_frame_syscalls = syscalls;
+            buffer.clear();
+            return result;
+        }
+    };
+}
@@ -0,0 +1,702 @@
+/**
+ * @file This file contains a fuzzy subsequence matcher and an incremental filter
+ * @details This file is licensed under the MIT license. If you decide to use this
+ *          file a copy of the following license must be provided. Giving credit in
+ *          form of a mention inside your source code, documentation or the final
+ *          product would be nice but is not required.
+ *
+ * Example
+ * +------------------------------------------------------------------+
+ * |  haevn::utils::FuzzyFilter filter;                               |
+ * |  filter.filter(entries, "hst12");                                |
+ * |  for(const haevn::utils::FuzzyMatch& match : filter.matches()){  |
+ * |      std::cout << entries[match.index] << std::endl;             |
+ * |  }                                                               |
+ * +------------------------------------------------------------------+
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Nils Milewski (haevn)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+ * @author Nils Milewski
+ * @version 1.0.0.0
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSE2__)
+    #include <immintrin.h>
+#endif
+
+#include "threadpool.hpp"
+#include "trace.hpp"
+
+namespace haevn::utils{
+
+    /**
+     * @brief This structure describes an entry which matched a query
+     */
+    struct FuzzyMatch{
+        /**
+         * @brief Score of the match, higher is better
+         */
+        std::int32_t score;
+
+        /**
+         * @brief Index of the entry inside the filtered source
+         */
+        std::uint32_t index;
+    };
+
+    /**
+     * @brief Generates the byte class table used by the fuzzy signature
+     * @details Letters are folded to 26 classes, digits get 10 classes and every other
+     *          byte shares one of the remaining 28 classes
+     * @return std::array<std::uint8_t, 256> Class of every byte
+     */
+    constexpr std::array<std::uint8_t, 256> fuzzyClassTable(){
+        std::array<std::uint8_t, 256> table{};
+        for(std::size_t i = 0; i < table.size(); i++){
+            if(i >= 'a' && i <= 'z'){
+                table[i] = i - 'a';
+            }else if(i >= 'A' && i <= 'Z'){
+                table[i] = i - 'A';
+            }else if(i >= '0' && i <= '9'){
+                table[i] = 26 + (i - '0');
+            }else{
+                table[i] = 36 + (i % 28);
+            }
+        }
+        return table;
+    }
+
+    /**
+     * @brief This class contains the fuzzy matching kernel
+     * @details A query matches a text if all query characters appear in the text in the same
+     *          order, ignoring the case of letters. Candidates are rejected early by comparing
+     *          64 bit byte class signatures, the subsequence is searched with SSE2/AVX2 compares
+     *          (scalar if neither is available) and only the final alignment is scored.
+     */
+    class Fuzzy{
+    private:
+        static constexpr std::array<std::uint8_t, 256> class_table = fuzzyClassTable();
+
+        static constexpr int score_match = 16;
+        static constexpr int bonus_boundary = 10;
+        static constexpr int bonus_consecutive = 8;
+        static constexpr int penalty_gap_start = 3;
+        static constexpr int penalty_gap_extension = 1;
+
+    public:
+        /**
+         * @brief Computes the byte class signature of a text
+         * @param text Text which should be described
+         * @return std::uint64_t One bit for every byte class which occurs in the text
+         */
+        static std::uint64_t signature(std::string_view text){
+            std::uint64_t result = 0;
+            for(unsigned char c : text){
+                result |= std::uint64_t(1) << class_table[c];
+            }
+            return result;
+        }
+
+        /**
+         * @brief Lowers the letters of a query
+         * @param query Query as typed
+         * @param lowered Target of the lowered query
+         */
+        static void lower(std::string_view query, std::string& lowered){
+            lowered.assign(query.data(), query.size());
+            for(char& c : lowered){
+                if(c >= 'A' && c <= 'Z'){
+                    c += 'a' - 'A';
+                }
+            }
+        }
+
+        /**
+         * @brief Finds a byte, ignoring the case of letters
+         * @param data Bytes which should be searched
+         * @param length Amount of bytes
+         * @param c Byte to find, letters must be lower case
+         * @return std::size_t Index of the first occurrence or length if not found
+         */
+        static std::size_t find(const char* data, std::size_t length, char c){
+            const bool letter = (c >= 'a' && c <= 'z');
+            const char fold = (letter ? 0x20 : 0);
+            std::size_t i = 0;
+#if defined(__AVX2__)
+            const __m256i needle32 = _mm256_set1_epi8(c);
+            const __m256i fold32 = _mm256_set1_epi8(fold);
+            for(; i + 32 <= length; i += 32){
+                __m256i bytes = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)), fold32);
+                unsigned int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, needle32));
+                if(mask != 0){
+                    return i + __builtin_ctz(mask);
+                }
+            }
+#endif
+#if defined(__SSE2__)
+            const __m128i needle16 = _mm_set1_epi8(c);
+            const __m128i fold16 = _mm_set1_epi8(fold);
+            for(; i + 16 <= length; i += 16){
+                __m128i bytes = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)), fold16);
+                unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, needle16));
+                if(mask != 0){
+                    return i + __builtin_ctz(mask);
+                }
+            }
+            if(i < length && length >= 16){
+                // The tail is compared with an overlapping load instead of byte by byte
+                std::size_t last = length - 16;
+                __m128i bytes = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + last)), fold16);
+                unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, needle16)) >> (i - last);
+                return (mask != 0 ? i + __builtin_ctz(mask) : length);
+            }
+#endif
+            for(; i < length; i++){
+                if((data[i] | fold) == c){
+                    return i;
+                }
+            }
+            return length;
+        }
+
+        /**
+         * @brief Matches a lowered query against a text
+         * @details The leftmost match is shortened from its end, so the scored alignment is the
+         *          shortest window which ends at the first possible position. Matches at word
+         *          boundaries and consecutive matches score higher, gaps score lower.
+         * @param text Text which should be matched
+         * @param query Lowered query, see lower
+         * @param score Score of the match, only written on success
+         * @param positions Optional target for the matched positions, must hold query.size() entries
+         * @return true If the query is a subsequence of the text
+         */
+        static bool match(std::string_view text, std::string_view query, std::int32_t& score, std::size_t* positions = nullptr){
+            if(query.empty()){
+                score = 0;
+                return true;
+            }
+
+            // Forward pass, finds the end of the leftmost match
+            std::size_t cursor = 0;
+            for(char c : query){
+                std::size_t found = find(text.data() + cursor, text.size() - cursor, c);
+                if(found == text.size() - cursor){
+                    return false;
+                }
+                cursor += found + 1;
+            }
+
+            // Backward pass, finds the start of the shortest window
+            std::size_t start = cursor;
+            for(std::size_t q = query.size(); q-- > 0;){
+                const char fold = (query[q] >= 'a' && query[q] <= 'z' ? 0x20 : 0);
+                do{
+                    start--;
+                }while((text[start] | fold) != query[q]);
+            }
+
+            // Scoring pass
+            std::int32_t result = 0;
+            std::size_t previous = start;
+            cursor = start;
+            for(std::size_t q = 0; q < query.size(); q++){
+                std::size_t position = cursor + find(text.data() + cursor, text.size() - cursor, query[q]);
+                result += score_match;
+                if(position == 0 || boundary(text[position - 1], text[position])){
+                    result += bonus_boundary;
+                }
+                if(q > 0){
+                    if(position == previous + 1){
+                        result += bonus_consecutive;
+                    }else{
+                        std::size_t gap = position - previous - 1;
+                        result -= penalty_gap_start + static_cast<std::int32_t>(std::min<std::size_t>(gap, 16)) * penalty_gap_extension;
+                    }
+                }
+                if(positions != nullptr){
+                    positions[q] = position;
+                }
+                previous = position;
+                cursor = position + 1;
+            }
+            // Prefer shorter texts on equal alignment
+            result -= static_cast<std::int32_t>(std::min<std::size_t>(text.size() >> 4, 8));
+            score = result;
+            return true;
+        }
+
+    private:
+
+        /**
+         * @brief Checks if a position starts a word
+         * @param previous Byte in front of the position
+         * @param current Byte at the position
+         * @return true If current starts a word, e.g. after a separator or a camel case hump
+         */
+        static bool boundary(char previous, char current){
+            bool previous_lower = (previous >= 'a' && previous <= 'z');
+            bool previous_upper = (previous >= 'A' && previous <= 'Z');
+            bool previous_digit = (previous >= '0' && previous <= '9');
+            if(!previous_lower && !previous_upper && !previous_digit){
+                return true;
+            }
+            if(previous_lower && current >= 'A' && current <= 'Z'){
+                return true;
+            }
+            return !previous_digit && current >= '0' && current <= '9';
+        }
+    };
+
+    /**
+     * @brief This class contains an incremental fuzzy filter
+     * @details The filter keeps the survivors of every query prefix. Appending a character only
+     *          matches the survivors of the previous query, removing a character reuses the stored
+     *          survivors. Signatures of the entries are computed once and reused by every query.
+     *          The best rank_limit matches are ordered by score, further matches are not ordered.
+     *          With a thread pool the candidates are split into chunks which are matched and
+     *          ranked in parallel, the partial rankings are merged afterwards. A running filter
+     *          can be cancelled through an atomic flag, e.g. once the next key was typed.
+     */
+    class FuzzyFilter{
+    private:
+        /**
+         * @brief Amount of candidates per parallel chunk
+         */
+        static constexpr std::size_t chunk_size = 16384;
+
+        /**
+         * @brief Amount of candidates between two checks of the cancel flag
+         */
+        static constexpr std::size_t cancel_interval = 1024;
+
+        std::string query_t;
+        std::string lowered;
+
+        /**
+         * @brief Survivors of every query prefix, stages[i] belongs to the first i + 1 characters
+         */
+        std::vector<std::vector<FuzzyMatch>> stages;
+
+        /**
+         * @brief Amount of stages which belong to the current query
+         */
+        std::size_t stage_count = 0;
+
+        /**
+         * @brief Survivors of the current query ordered by score
+         * @details The stages keep the order in which survivors were found, so the survivors
+         *          of appended entries stay at their end. Only the result is ranked.
+         */
+        std::vector<FuzzyMatch> ranked;
+
+        /**
+         * @brief Survivors of every chunk of the stage which is computed
+         */
+        std::vector<std::vector<FuzzyMatch>> chunks;
+
+        /**
+         * @brief Signatures of the entries, computed on demand
+         */
+        std::vector<std::uint64_t> signatures;
+
+        /**
+         * @brief Amount of matches which are ordered by score
+         */
+        std::size_t rank_limit;
+
+    public:
+        /**
+         * @brief Construct a new filter
+         * @param rank_limit_t Amount of matches which are ordered by score
+         */
+        explicit FuzzyFilter(std::size_t rank_limit_t = 10000) : rank_limit(rank_limit_t){}
+
+        /**
+         * @brief Gets the current query
+         * @details After a cancelled filter this is the longest query whose matches are complete
+         */
+        const std::string& query() const{
+            return query_t;
+        }
+
+        /**
+         * @brief Gets the lowered current query, as used by Fuzzy::match
+         */
+        const std::string& loweredQuery() const{
+            return lowered;
+        }
+
+        /**
+         * @brief Indicates that a query is set
+         * @details Without a query every entry matches and matches() is empty
+         */
+        bool active() const{
+            return stage_count > 0;
+        }
+
+        /**
+         * @brief Gets the matches of the current query
+         * @return const std::vector<FuzzyMatch>& Matches, the best first
+         */
+        const std::vector<FuzzyMatch>& matches() const{
+            return ranked;
+        }
+
+        /**
+         * @brief Forgets all survivors and signatures, e.g. after the entries changed
+         */
+        void reset(){
+            query_t.clear();
+            lowered.clear();
+            stage_count = 0;
+            signatures.clear();
+        }
+
+        /**
+         * @brief Filters a source with a new query
+         * @tparam Source Type which provides size() and operator[] convertible to std::string_view,
+         *                operator[] must be callable from several threads if a pool is used
+         * @param source Entries which should be filtered
+         * @param query New query
+         * @param pool Optional pool which matches the candidates in parallel
+         * @param cancel Optional flag which stops the filter once it is set
+         * @return true If the filter completed, false if it was cancelled
+         */
+        template<typename Source>
+        bool filter(const Source& source, std::string_view query, ThreadPool* pool = nullptr, const std::atomic<bool>* cancel = nullptr){
+            HAEVN_TRACE_SCOPE("fuzzy", "filter");
+            std::string next;
+            Fuzzy::lower(query, next);
+
+            std::size_t common = 0;
+            while(common < stage_count && common < next.size() && lowered[common] == next[common]){
+                common++;
+            }
+            bool reused = (common < stage_count);
+            stage_count = common;
+            lowered.swap(next);
+            if(lowered.empty()){
+                query_t.clear();
+                ranked.clear();
+                return true;
+            }
+
+            // A reused stage belongs to the whole query now, e.g. after a backspace
+            if(reused && stage_count > 0){
+                rankStage(stage_count - 1);
+            }
+            // Entries which were appended meanwhile must pass the reused stages too
+            extend(source, pool);
+            if(stages.size() < lowered.size()){
+                stages.resize(lowered.size());
+            }
+            for(std::size_t i = stage_count; i < lowered.size(); i++){
+                if(!computeStage(source, i, i + 1 == lowered.size(), pool, cancel)){
+                    // Keep the longest complete query
+                    lowered.resize(stage_count);
+                    query_t.assign(query.data(), stage_count);
+                    if(i > common){
+                        rankStage(stage_count - 1);
+                    }
+                    return false;
+                }
+                stage_count = i + 1;
+            }
+            query_t.assign(query.data(), query.size());
+            return true;
+        }
+
+        /**
+         * @brief Filters a source in the background until an interrupt occurs
+         * @details The filter runs as a task of \p pool while the calling thread polls
+         *          \p interrupted, e.g. whether a key was typed. Once it returns true the
+         *          filter is cancelled and the longest completed query is kept. Small sources
+         *          are filtered by the calling thread.
+         * @tparam Source Type which provides size() and operator[] convertible to std::string_view
+         * @tparam Interrupted Callable returning true once the filter should be cancelled,
+         *                     it should block a few milliseconds at most
+         * @param source Entries which should be filtered
+         * @param query New query
+         * @param pool Pool which matches the candidates in parallel
+         * @param interrupted Interrupt condition
+         * @return true If the filter completed, false if it was cancelled
+         */
+        template<typename Source, typename Interrupted>
+        bool filterInterruptible(const Source& source, std::string_view query, ThreadPool& pool, Interrupted interrupted){
+            if(source.size() < 2 * chunk_size){
+                return filter(source, query);
+            }
+            ThreadPool::Group group;
+            std::atomic<bool> cancel{false};
+            bool completed = false;
+            pool.submit(group, [&]{
+                completed = filter(source, query, &pool, &cancel);
+            });
+            while(!group.done() && !interrupted()){}
+            cancel.store(true, std::memory_order_relaxed);
+            pool.wait(group);
+            return completed;
+        }
+
+        /**
+         * @brief Includes entries which were appended to the source since the last filter
+         * @details Only the new entries are matched against every stage of the current query,
+         *          their ranking is merged with the existing one. Streaming sources call it
+         *          whenever they grew instead of filtering everything again.
+         * @tparam Source Type which provides size() and operator[] convertible to std::string_view
+         * @param source Entries which were filtered, only appended to since
+         * @param pool Optional pool which matches the new entries in parallel
+         * @return std::size_t Amount of new entries
+         */
+        template<typename Source>
+        std::size_t extend(const Source& source, ThreadPool* pool = nullptr){
+            std::size_t known = signatures.size();
+            updateSignatures(source, pool);
+            std::size_t count = signatures.size() - known;
+            if(count == 0 || stage_count == 0){
+                return count;
+            }
+
+            for(std::size_t stage = 0; stage < stage_count; stage++){
+                std::vector<FuzzyMatch>& target = stages[stage];
+                bool last = (stage + 1 == stage_count);
+                const FuzzyMatch* candidates = nullptr;
+                if(stage > 0){
+                    // The new survivors of the previous stage were appended to its end
+                    candidates = stages[stage - 1].data() + stages[stage - 1].size() - count;
+                }
+                std::size_t amount = matchChunks(source, stage, candidates, known, count, last, pool, nullptr);
+                std::size_t previous = target.size();
+                concatenate(target, amount);
+                if(last){
+                    // The existing ranking takes part in the merge as another chunk
+                    chunks[amount].swap(ranked);
+                    ranked.clear();
+                    merge(ranked, amount + 1);
+                }
+                count = target.size() - previous;
+            }
+            return signatures.size() - known;
+        }
+
+    private:
+
+        /**
+         * @brief Executes a function for every chunk of a range
+         * @param count Amount of elements
+         * @param pool Optional pool, without a pool the chunks are executed by the caller
+         * @param function Function which gets the chunk index, its first and its last element
+         */
+        template<typename Function>
+        static void forEachChunk(std::size_t count, ThreadPool* pool, Function function){
+            std::size_t amount = (count + chunk_size - 1) / chunk_size;
+            if(pool == nullptr || amount < 2){
+                for(std::size_t chunk = 0; chunk < amount; chunk++){
+                    HAEVN_TRACE_SCOPE("fuzzy", "chunk");
+                    function(chunk, chunk * chunk_size, std::min(count, (chunk + 1) * chunk_size));
+                }
+                return;
+            }
+            ThreadPool::Group group;
+            for(std::size_t chunk = 0; chunk < amount; chunk++){
+                pool->submit(group, [&function, chunk, count]{
+                    HAEVN_TRACE_SCOPE("fuzzy", "chunk");
+                    function(chunk, chunk * chunk_size, std::min(count, (chunk + 1) * chunk_size));
+                });
+            }
+            pool->wait(group);
+        }
+
+        /**
+         * @brief Computes the signatures of entries which were not seen before
+         */
+        template<typename Source>
+        void updateSignatures(const Source& source, ThreadPool* pool){
+            std::size_t known = signatures.size();
+            std::size_t size = source.size();
+            if(size <= known){
+                return;
+            }
+            signatures.resize(size);
+            forEachChunk(size - known, pool, [&](std::size_t, std::size_t first, std::size_t last){
+                for(std::size_t i = known + first; i < known + last; i++){
+                    signatures[i] = Fuzzy::signature(std::string_view(source[i]));
+                }
+            });
+        }
+
+        /**
+         * @brief Computes the survivors of the query prefix with \p stage + 1 characters
+         * @param source Entries which are filtered
+         * @param stage Index of the stage
+         * @param last Indicates that the stage belongs to the whole query and must be ranked
+         * @param pool Optional pool
+         * @param cancel Optional cancel flag
+         * @return true If the stage was completed
+         */
+        template<typename Source>
+        bool computeStage(const Source& source, std::size_t stage, bool last, ThreadPool* pool, const std::atomic<bool>* cancel){
+            const std::vector<FuzzyMatch>* candidates = (stage > 0 ? &stages[stage - 1] : nullptr);
+            // The source may grow meanwhile, only entries with a signature are matched
+            std::size_t count = (candidates != nullptr ? candidates->size() : signatures.size());
+            std::size_t amount = matchChunks(source, stage, (candidates != nullptr ? candidates->data() : nullptr), 0, count, last, pool, cancel);
+            if(amount == cancelled_chunks){
+                return false;
+            }
+            stages[stage].clear();
+            concatenate(stages[stage], amount);
+            if(last){
+                ranked.clear();
+                merge(ranked, amount);
+            }
+            return true;
+        }
+
+        /**
+         * @brief Ranks a stored stage as the result, e.g. after a backspace
+         * @param stage Index of the stage
+         */
+        void rankStage(std::size_t stage){
+            ranked.assign(stages[stage].begin(), stages[stage].end());
+            rank(ranked);
+        }
+
+        /**
+         * @brief Marks a cancelled matchChunks
+         */
+        static constexpr std::size_t cancelled_chunks = ~std::size_t(0);
+
+        /**
+         * @brief Matches candidates against a query prefix, the survivors are stored in chunks
+         * @param source Entries which are filtered
+         * @param stage Index of the stage, the prefix has \p stage + 1 characters
+         * @param candidates Candidates or nullptr to match the indices offset to offset + count
+         * @param offset First index if no candidates are given
+         * @param count Amount of candidates
+         * @param last Indicates that every chunk must be ranked
+         * @param pool Optional pool
+         * @param cancel Optional cancel flag
+         * @return std::size_t Amount of used chunks or cancelled_chunks
+         */
+        template<typename Source>
+        std::size_t matchChunks(const Source& source, std::size_t stage, const FuzzyMatch* candidates, std::size_t offset, std::size_t count, bool last, ThreadPool* pool, const std::atomic<bool>* cancel){
+            std::string_view query(lowered.data(), stage + 1);
+            std::uint64_t required = Fuzzy::signature(query);
+            std::atomic<bool> cancelled{false};
+
+            std::size_t amount = (count + chunk_size - 1) / chunk_size;
+            // One more chunk for extend
+            if(chunks.size() < amount + 1){
+                chunks.resize(amount + 1);
+            }
+
+            forEachChunk(count, pool, [&](std::size_t chunk, std::size_t first, std::size_t end){
+                std::vector<FuzzyMatch>& result = chunks[chunk];
+                result.clear();
+                std::int32_t score;
+                for(std::size_t i = first; i < end; i++){
+                    if((i - first) % cancel_interval == 0 && cancel != nullptr && cancel->load(std::memory_order_relaxed)){
+                        cancelled.store(true, std::memory_order_relaxed);
+                        return;
+                    }
+                    std::uint32_t index = (candidates != nullptr ? candidates[i].index : static_cast<std::uint32_t>(offset + i));
+                    if((signatures[index] & required) == required && Fuzzy::match(std::string_view(source[index]), query, score)){
+                        result.push_back(FuzzyMatch{score, index});
+                    }
+                }
+                if(last){
+                    rank(result);
+                }
+            });
+
+            return (cancelled.load() ? cancelled_chunks : amount);
+        }
+
+        /**
+         * @brief Appends the survivors of all chunks
+         * @param result Target of the survivors
+         * @param amount Amount of chunks
+         */
+        void concatenate(std::vector<FuzzyMatch>& result, std::size_t amount){
+            for(std::size_t chunk = 0; chunk < amount; chunk++){
+                result.insert(result.end(), chunks[chunk].begin(), chunks[chunk].end());
+            }
+        }
+
+        /**
+         * @brief Merges ranked chunks
+         * @details The best rank_limit matches of all chunks are merged in order, the
+         *          remaining matches are appended
+         * @param result Target of the survivors
+         * @param amount Amount of chunks
+         */
+        void merge(std::vector<FuzzyMatch>& result, std::size_t amount){
+            std::vector<std::size_t> heads(amount, 0);
+            auto better = [](const FuzzyMatch& a, const FuzzyMatch& b){
+                return a.score > b.score || (a.score == b.score && a.index < b.index);
+            };
+
+            while(result.size() < rank_limit){
+                std::size_t best = amount;
+                for(std::size_t chunk = 0; chunk < amount; chunk++){
+                    std::size_t ranked = std::min(chunks[chunk].size(), rank_limit);
+                    if(heads[chunk] < ranked && (best == amount || better(chunks[chunk][heads[chunk]], chunks[best][heads[best]]))){
+                        best = chunk;
+                    }
+                }
+                if(best == amount){
+                    break;
+                }
+                result.push_back(chunks[best][heads[best]++]);
+            }
+            for(std::size_t chunk = 0; chunk < amount; chunk++){
+                result.insert(result.end(), chunks[chunk].begin() + heads[chunk], chunks[chunk].end());
+            }
+        }
+
+        /**
+         * @brief Orders the best matches by score, ties by index
+         */
+        void rank(std::vector<FuzzyMatch>& matches){
+            auto better = [](const FuzzyMatch& a, const FuzzyMatch& b){
+                return a.score > b.score || (a.score == b.score && a.index < b.index);
+            };
+            if(matches.size() > rank_limit){
+                std::nth_element(matches.begin(), matches.begin() + rank_limit, matches.end(), better);
+                std::sort(matches.begin(), matches.begin() + rank_limit, better);
+            }else{
+                std::sort(matches.begin(), matches.end(), better);
+            }
+        }
+    };
+}
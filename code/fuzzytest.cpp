@@ -0,0 +1,97 @@
+#include "fuzzy.hpp"
+#include "threadpool.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * Checks that the incremental fuzzy filter ranks like a fresh filter
+ * Every query of a typing sequence, including backspaces and appended entries, is compared
+ * against a new filter of the same query. The order of the matches must be equal.
+ * Usage: ./fuzzytest
+ */
+
+static int failures = 0;
+
+/**
+ * Default rank limit of FuzzyFilter
+ */
+static const std::size_t rank_limit = 10000;
+
+static void compare(const char* name, haevn::utils::FuzzyFilter& filter, const std::vector<std::string>& entries, const std::string& query){
+    haevn::utils::FuzzyFilter fresh;
+    fresh.filter(entries, query);
+    std::vector<haevn::utils::FuzzyMatch> expected = fresh.matches();
+    std::vector<haevn::utils::FuzzyMatch> actual = filter.matches();
+    // Matches behind the ranked ones are not ordered
+    auto byIndex = [](const haevn::utils::FuzzyMatch& a, const haevn::utils::FuzzyMatch& b){ return a.index < b.index; };
+    if(actual.size() > rank_limit){
+        std::sort(actual.begin() + rank_limit, actual.end(), byIndex);
+    }
+    if(expected.size() > rank_limit){
+        std::sort(expected.begin() + rank_limit, expected.end(), byIndex);
+    }
+    bool equal = (expected.size() == actual.size());
+    for(std::size_t i = 0; equal && i < actual.size(); i++){
+        equal = (expected[i].index == actual[i].index && expected[i].score == actual[i].score);
+    }
+    if(!equal){
+        failures++;
+        std::printf("FAILED %s \"%s\": %zu matches", name, query.c_str(), actual.size());
+        for(std::size_t i = 0; i < actual.size() && i < 10; i++){
+            std::printf(" %u/%d", actual[i].index, actual[i].score);
+        }
+        std::printf(", expected %zu", expected.size());
+        for(std::size_t i = 0; i < expected.size() && i < 10; i++){
+            std::printf(" %u/%d", expected[i].index, expected[i].score);
+        }
+        std::printf("\n");
+    }
+}
+
+static void type(const char* name, haevn::utils::FuzzyFilter& filter, const std::vector<std::string>& entries, const std::vector<std::string>& queries){
+    for(const std::string& query : queries){
+        filter.filter(entries, query);
+        compare(name, filter, entries, query);
+    }
+}
+
+int main(){
+    std::vector<std::string> entries = {"xaxxxxxxxxb", "zzzzzzzzza", "ab", "a-b", "bbbbbbbbba"};
+
+    haevn::utils::FuzzyFilter backspace;
+    type("backspace", backspace, entries, {"ab", "a"});
+
+    haevn::utils::FuzzyFilter retype;
+    type("retype", retype, entries, {"a", "ab", "a", "ab", "", "b", "ba", "b"});
+
+    haevn::utils::FuzzyFilter replace;
+    type("replace", replace, entries, {"abx", "ab", "b", "bb"});
+
+    // Entries appended after a backspace are ranked with the reused stage
+    haevn::utils::FuzzyFilter streaming;
+    type("streaming", streaming, entries, {"ab", "a"});
+    entries.push_back("aaaa");
+    entries.push_back("a_b");
+    streaming.extend(entries);
+    compare("streaming", streaming, entries, "a");
+    entries.push_back("cab");
+    type("streaming", streaming, entries, {"ab", "a", "ab"});
+
+    // Several chunks are matched in parallel
+    std::vector<std::string> many;
+    for(std::size_t i = 0; i < 100000; i++){
+        many.push_back(std::to_string(i * 7919) + (i % 3 == 0 ? "-alpha" : "-beta"));
+    }
+    haevn::utils::ThreadPool pool(4);
+    haevn::utils::FuzzyFilter parallel;
+    for(const char* query : {"al", "alp", "al", "a", "be", "b"}){
+        parallel.filter(many, query, &pool);
+        compare("parallel", parallel, many, query);
+    }
+
+    std::printf("%s\n", failures == 0 ? "OK" : "FAILED");
+    return (failures == 0 ? 0 : 1);
+}
@@ -0,0 +1,4 @@
+#!/bin/bash
+rm fuzzytest
+g++ -O2 -pthread fuzzytest.cpp -o fuzzytest
+./fuzzytest
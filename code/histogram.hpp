@@ -0,0 +1,271 @@
+/**
+ * @file This file contains a log bucketed latency histogram
+ * @details This file is licensed under the MIT license. If you decide to use this
+ *          file a copy of the following license must be provided. Giving credit in
+ *          form of a mention inside your source code, documentation or the final
+ *          product would be nice but is not required.
+ *          The keystroke to paint latency of every widget is recorded into
+ *          Histogram::keystrokes(). Set HAEVN_LATENCY_REPORT to print it at exit.
+ *
+ * Example
+ * +--------------------------------------------------------------------+
+ * |  menu.getSelection();                                              |
+ * |  auto& latency = haevn::utils::Histogram::keystrokes();            |
+ * |  if(latency.percentile(0.99) > 30000000){                          |
+ * |      std::cerr << "p99 above 30 ms\n";                             |
+ * |  }                                                                 |
+ * |  latency.print(std::cerr, "keystroke to paint");                   |
+ * +--------------------------------------------------------------------+
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Nils Milewski (haevn)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+ * @author Nils Milewski
+ * @version 1.0.0.0
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+#include "utils.hpp"
+
+namespace haevn::utils{
+
+    /**
+     * @brief This class contains a log bucketed histogram of durations
+     * @details Values below 64 ns get an own bucket, larger values are split into 32 buckets
+     *          per power of two, so every percentile is off by at most 3.2%. Recording costs
+     *          a few instructions and relaxed atomic adds, it can be done from any thread.
+     */
+    class Histogram{
+    private:
+        static constexpr int sub_bits = 5;
+        static constexpr std::size_t linear = 64;
+        static constexpr std::size_t bucket_count = linear + (64 - 6) * (1 << sub_bits);
+
+        std::array<std::atomic<std::uint64_t>, bucket_count> buckets{};
+        std::atomic<std::uint64_t> total{0};
+        std::atomic<std::uint64_t> maximum{0};
+
+    public:
+        Histogram(){}
+
+        Histogram(const Histogram&) = delete;
+        Histogram& operator=(const Histogram&) = delete;
+
+        /**
+         * @brief Records a duration
+         * @param nanoseconds Duration in nanoseconds
+         */
+        void record(std::uint64_t nanoseconds){
+            buckets[index(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+            total.fetch_add(1, std::memory_order_relaxed);
+            std::uint64_t current = maximum.load(std::memory_order_relaxed);
+            while(nanoseconds > current && !maximum.compare_exchange_weak(current, nanoseconds, std::memory_order_relaxed)){ }
+        }
+
+        /**
+         * @brief Gets the amount of recorded durations
+         */
+        std::uint64_t count() const{
+            return total.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Gets the longest recorded duration
+         */
+        std::uint64_t max() const{
+            return maximum.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Gets a percentile
+         * @param quantile Quantile between 0 and 1, e.g. 0.99
+         * @return std::uint64_t Highest duration of the bucket containing the quantile in nanoseconds, 0 if empty
+         */
+        std::uint64_t percentile(double quantile) const{
+            std::uint64_t amount = count();
+            if(amount == 0){
+                return 0;
+            }
+            std::uint64_t rank = static_cast<std::uint64_t>(quantile * amount);
+            rank = (rank < 1 ? 1 : (rank > amount ? amount : rank));
+            std::uint64_t seen = 0;
+            for(std::size_t i = 0; i < bucket_count; i++){
+                seen += buckets[i].load(std::memory_order_relaxed);
+                if(seen >= rank){
+                    std::uint64_t highest = upper(i);
+                    return (highest < max() ? highest : max());
+                }
+            }
+            return max();
+        }
+
+        /**
+         * @brief Counts the durations above a limit, e.g. to check a latency objective
+         * @param nanoseconds Limit in nanoseconds
+         * @return std::uint64_t Amount of durations in buckets above the limit
+         */
+        std::uint64_t above(std::uint64_t nanoseconds) const{
+            std::uint64_t amount = 0;
+            for(std::size_t i = index(nanoseconds) + 1; i < bucket_count; i++){
+                amount += buckets[i].load(std::memory_order_relaxed);
+            }
+            return amount;
+        }
+
+        /**
+         * @brief Removes every recorded duration
+         */
+        void reset(){
+            for(std::atomic<std::uint64_t>& bucket : buckets){
+                bucket.store(0, std::memory_order_relaxed);
+            }
+            total.store(0, std::memory_order_relaxed);
+            maximum.store(0, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Prints count, p50, p99, p999 and max in milliseconds
+         * @param output Stream where the summary is printed
+         * @param name Name which precedes the summary
+         */
+        void print(std::ostream& output, const char* name) const{
+            char line[256];
+            std::snprintf(line, sizeof(line), "%s: count %llu p50 %.3f ms p99 %.3f ms p999 %.3f ms max %.3f ms\n", name,
+                          static_cast<unsigned long long>(count()), percentile(0.5) / 1e6, percentile(0.99) / 1e6,
+                          percentile(0.999) / 1e6, max() / 1e6);
+            output << line;
+        }
+
+        /**
+         * @brief Gets the histogram of the time from receiving an input byte until the next frame was written
+         * @details Filled by TerminalSession and the widgets, see PaintLatency. If the environment
+         *          variable HAEVN_LATENCY_REPORT is set, a summary is printed to stderr at exit.
+         */
+        static Histogram& keystrokes(){
+            // Never destroyed, the exit handler may run after static destructors
+            static Histogram* instance = create();
+            return *instance;
+        }
+
+        /**
+         * @brief Prints keystrokes() to stderr at exit
+         */
+        static void reportAtExit(){
+            static std::atomic<bool> registered{false};
+            if(!registered.exchange(true)){
+                std::atexit(&Histogram::onExit);
+            }
+        }
+
+    private:
+
+        static Histogram* create(){
+            Histogram* histogram = new Histogram();
+            if(std::getenv("HAEVN_LATENCY_REPORT") != nullptr){
+                reportAtExit();
+            }
+            return histogram;
+        }
+
+        static void onExit();
+
+        static std::size_t index(std::uint64_t value){
+            if(value < linear){
+                return static_cast<std::size_t>(value);
+            }
+            int exponent = 63 - __builtin_clzll(value);
+            std::size_t sub = (value >> (exponent - sub_bits)) & ((1 << sub_bits) - 1);
+            return linear + (exponent - 6) * (1 << sub_bits) + sub;
+        }
+
+        static std::uint64_t upper(std::size_t index){
+            if(index < linear){
+                return index;
+            }
+            int exponent = static_cast<int>((index - linear) >> sub_bits) + 6;
+            std::uint64_t sub = (index - linear) & ((1 << sub_bits) - 1);
+            std::uint64_t lower = ((1ULL << sub_bits) + sub) << (exponent - sub_bits);
+            return lower + (1ULL << (exponent - sub_bits)) - 1;
+        }
+    };
+
+    /**
+     * @brief This class measures the time from an input byte to the next frame
+     * @details TerminalSession reports when input arrived through its input callback, which
+     *          is installed when this file is included, the interactive widgets report when
+     *          they presented their frame. Other output, e.g. progressbars, does not take part. The first unpainted input is measured, so a burst which is drawn
+     *          with one frame counts once. Input which changes nothing is not recorded.
+     */
+    class PaintLatency{
+    private:
+        static std::atomic<std::int64_t>& pending(){
+            static std::atomic<std::int64_t> instance{0};
+            return instance;
+        }
+
+        static std::int64_t now(){
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+    public:
+        /**
+         * @brief Called when input was read
+         */
+        static void input(){
+            std::int64_t none = 0;
+            if(pending().load(std::memory_order_relaxed) == 0){
+                pending().compare_exchange_strong(none, now(), std::memory_order_relaxed);
+            }
+        }
+
+        /**
+         * @brief Called when a widget flushed its frame
+         * @param wrote False if the frame was unchanged, the input is dropped without a record
+         */
+        static void painted(bool wrote = true){
+            if(pending().load(std::memory_order_relaxed) == 0){
+                return;
+            }
+            std::int64_t arrived = pending().exchange(0, std::memory_order_relaxed);
+            if(arrived != 0 && wrote){
+                Histogram::keystrokes().record(static_cast<std::uint64_t>(now() - arrived));
+            }
+        }
+    };
+
+    inline void Histogram::onExit(){
+        keystrokes().print(std::cerr, "keystroke to paint");
+    }
+
+    /**
+     * @brief Reports input of TerminalSession to PaintLatency once this file is included
+     */
+    inline const bool paint_latency_installed = (TerminalSession::onInput(&PaintLatency::input), true);
+}
@@ -1,6 +1,15 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
 #include "utils.hpp"
+#include "trace.hpp"
 
 namespace haevn::utils{
 
@@ -149,34 +158,552 @@ namespace haevn::utils{
         NONE 
     };
 
+    /**
+     * @brief Actions which can be reported for a key
+     * @details The values correspond to the event types of the kitty keyboard protocol
+     */
+    enum key_action{
+        PRESSED = 1,
+        REPEATED,
+        RELEASED
+    };
+
+    /**
+     * @brief This structure describes a single keyboard event
+     */
+    struct KeyEvent{
+        keys key;
+        key_action action;
+    };
+
+    /**
+     * @brief Generates the table for sequences like ESC [ A and ESC O P
+     * @return std::array<keys, 64> Key for every final byte between '@' and DEL
+     */
+    constexpr std::array<keys, 64> decoderFinalTable(){
+        std::array<keys, 64> table{};
+        for(std::size_t i = 0; i < table.size(); i++){
+            table[i] = NONE;
+        }
+        table['A' - '@'] = ARROW_UP;
+        table['B' - '@'] = ARROW_DOWN;
+        table['C' - '@'] = ARROW_RIGHT;
+        table['D' - '@'] = ARROW_LEFT;
+        table['H' - '@'] = POS;
+        table['F' - '@'] = END;
+        table['P' - '@'] = F1;
+        table['Q' - '@'] = F2;
+        table['R' - '@'] = F3;
+        table['S' - '@'] = F4;
+        table['M' - '@'] = ENTER;
+        table['Z' - '@'] = TAB;
+        return table;
+    }
+
+    /**
+     * @brief Generates the table for sequences like ESC [ 5 ~
+     * @return std::array<keys, 35> Key for every numeric parameter
+     */
+    constexpr std::array<keys, 35> decoderTildeTable(){
+        std::array<keys, 35> table{};
+        for(std::size_t i = 0; i < table.size(); i++){
+            table[i] = NONE;
+        }
+        table[1] = POS;
+        table[2] = INS;
+        table[3] = ENTF;
+        table[4] = END;
+        table[5] = BILDUP;
+        table[6] = BILDOWN;
+        table[7] = POS;
+        table[8] = END;
+        table[11] = F1;
+        table[12] = F2;
+        table[13] = F3;
+        table[14] = F4;
+        table[15] = F5;
+        table[17] = F6;
+        table[18] = F7;
+        table[19] = F8;
+        table[20] = F9;
+        table[21] = F10;
+        table[23] = F11;
+        table[24] = F12;
+        return table;
+    }
+
+    /**
+     * @brief This class decodes terminal input into keys
+     * @details The decoder is a state machine which consumes one byte at a time, therefore
+     *          decoding costs O(sequence length) and never allocates. CSI (ESC [) and SS3 (ESC O)
+     *          sequences are translated with lookup tables which are generated at compile time.
+     *          Modifier parameters are ignored and Alt combinations are reported as the plain key.
+     */
+    class KeyDecoder{
+    public:
+        /**
+         * @brief Time in milliseconds after which a lone ESC is reported
+         */
+        static constexpr int escape_timeout = 25;
+
+    private:
+        enum state{
+            GROUND,
+            ESCAPE,
+            CSI,
+            SS3,
+            LINUX_FUNCTION
+        };
+
+        static constexpr std::array<keys, 64> final_table = decoderFinalTable();
+        static constexpr std::array<keys, 35> tilde_table = decoderTildeTable();
+
+        state current = GROUND;
+
+        /**
+         * @brief First numeric parameter of the current sequence
+         */
+        int parameter = 0;
+
+        /**
+         * @brief Amount of parameter separators inside the current sequence
+         */
+        int separators = 0;
+
+        /**
+         * @brief Amount of sub parameter separators inside the current parameter
+         */
+        int colons = 0;
+
+        /**
+         * @brief Indicates that the current sequence is a reply to a query
+         */
+        bool query = false;
+
+        /**
+         * @brief Action of the last completed key
+         */
+        key_action last_action = PRESSED;
+
+        /**
+         * @brief Indicates that the last completed sequence was a kitty keyboard protocol reply
+         */
+        bool last_reply = false;
+
+    public:
+
+        /**
+         * @brief Consumes one byte
+         * @param byte Byte which was read from the terminal
+         * @param key Decoded key, only written if a key was completed
+         * @return true If \p byte completed a key
+         */
+        bool feed(unsigned char byte, keys& key){
+            if(current == GROUND || current == ESCAPE){
+                last_action = PRESSED;
+                last_reply = false;
+            }
+            switch(current){
+                case GROUND:
+                    if(byte == ESC){
+                        current = ESCAPE;
+                        return false;
+                    }
+                    key = plain(byte);
+                    return true;
+
+                case ESCAPE:
+                    if(byte == '['){
+                        current = CSI;
+                        parameter = 0;
+                        separators = 0;
+                        colons = 0;
+                        query = false;
+                        return false;
+                    }
+                    if(byte == 'O'){
+                        current = SS3;
+                        return false;
+                    }
+                    current = GROUND;
+                    key = plain(byte);
+                    return true;
+
+                case CSI:
+                    if(byte >= '0' && byte <= '9'){
+                        if(separators == 0 && colons == 0 && parameter < 1000){
+                            parameter = parameter * 10 + (byte - '0');
+                        }else if(separators == 1 && colons == 1){
+                            // Event type of the kitty keyboard protocol
+                            last_action = static_cast<key_action>(byte - '0');
+                        }
+                        return false;
+                    }
+                    if(byte == '[' && parameter == 0){
+                        current = LINUX_FUNCTION;
+                        return false;
+                    }
+                    if(byte == ';'){
+                        separators++;
+                        colons = 0;
+                        return false;
+                    }
+                    if(byte == ':'){
+                        colons++;
+                        return false;
+                    }
+                    if(byte == '?'){
+                        query = true;
+                        return false;
+                    }
+                    if(byte < '@' || byte > '~'){
+                        // Private markers and intermediate bytes
+                        return false;
+                    }
+                    current = GROUND;
+                    if(byte == '~'){
+                        key = (parameter < static_cast<int>(tilde_table.size()) ? tilde_table[parameter] : NONE);
+                    }else if(byte == 'u'){
+                        // Kitty keyboard protocol, the parameter is the unicode codepoint
+                        last_reply = query;
+                        key = (!query && parameter < 128 ? plain(parameter) : NONE);
+                    }else{
+                        key = final_table[byte - '@'];
+                    }
+                    return true;
+
+                case SS3:
+                    current = GROUND;
+                    key = (byte >= '@' && byte <= '~' ? final_table[byte - '@'] : NONE);
+                    return true;
+
+                case LINUX_FUNCTION:
+                    current = GROUND;
+                    key = (byte >= 'A' && byte <= 'E' ? static_cast<keys>(F1 + (byte - 'A')) : NONE);
+                    return true;
+            }
+            return false;
+        }
+
+        /**
+         * @brief Indicates that an incomplete sequence was consumed
+         * @return true If more bytes are required to complete a key
+         */
+        bool pending() const{
+            return current != GROUND;
+        }
+
+        /**
+         * @brief Gets the action of the last completed key
+         * @details Only the kitty keyboard protocol reports repeats and releases, every
+         *          other key is reported as PRESSED
+         * @return key_action Action of the last key
+         */
+        key_action action() const{
+            return last_action;
+        }
+
+        /**
+         * @brief Indicates that the last completed sequence answered a kitty protocol query
+         * @details Such a sequence completes with key NONE
+         * @return true If the terminal supports the kitty keyboard protocol
+         */
+        bool kittyReply() const{
+            return last_reply;
+        }
+
+        /**
+         * @brief Completes the current sequence after a timeout
+         * @details A lone ESC is reported as ESC, an incomplete sequence as NONE
+         * @return keys Key which was pending
+         */
+        keys flush(){
+            keys key = (current == ESCAPE ? ESC : NONE);
+            current = GROUND;
+            return key;
+        }
+
+        /**
+         * @brief Reads and decodes one key
+         * @details Bytes following an ESC are awaited for at most escape_timeout milliseconds,
+         *          afterwards the ESC is reported on its own.
+         * @param session Session which provides the input
+         * @param timeout_ms Timeout for the first byte in milliseconds, negative values block
+         * @return keys Key which was read or NONE if nothing arrived in time
+         */
+        static keys read(TerminalSession& session, int timeout_ms = -1){
+            HAEVN_TRACE_SCOPE("input", "read key");
+            KeyDecoder decoder;
+            keys key = NONE;
+            int c = session.get(timeout_ms);
+            if(c == EOF){
+                return NONE;
+            }
+            while(!decoder.feed(c, key)){
+                c = session.get(escape_timeout);
+                if(c == EOF){
+                    return decoder.flush();
+                }
+            }
+            return key;
+        }
+
+    private:
+
+        /**
+         * @brief Translates a single byte
+         * @param byte Byte which was read
+         * @return keys Corresponding key
+         */
+        static keys plain(unsigned char byte){
+            if(byte == '\r'){
+                return ENTER;
+            }
+            if(byte == '\b'){
+                return BACK_SPACE;
+            }
+            return static_cast<keys>(byte);
+        }
+    };
+
+    /**
+     * @brief This class contains a non blocking keyboard
+     * @details A reader thread polls the terminal, decodes the input and fills a key state
+     *          table as well as a bounded event queue. keyPressed and keyReleased only read the
+     *          table, therefore they answer in O(1) without a syscall and can be called inside
+     *          hot loops, e.g. to check for a cancel key while a progressbar is running.
+     *          If the terminal supports the kitty keyboard protocol, key releases are reported
+     *          too, otherwise a key counts as pressed until the press was queried once.
+     *          While the keyboard is running it owns the terminal input, stop() it before
+     *          using a blocking widget.
+     */
     class Keyboard{
     private:
-     
+        /**
+         * @brief Flags inside the key state table
+         */
+        static constexpr std::uint8_t DOWN = 1;
+        static constexpr std::uint8_t PRESS_SEEN = 2;
+        static constexpr std::uint8_t RELEASE_SEEN = 4;
+
+        /**
+         * @brief Capacity of the event queue, must be a power of two
+         */
+        static constexpr std::size_t queue_size = 256;
+
+        std::array<std::atomic<std::uint8_t>, NONE + 1> table{};
+
+        std::array<KeyEvent, queue_size> queue;
+        std::atomic<std::size_t> head{0};
+        std::atomic<std::size_t> tail{0};
+
+        std::mutex mutex;
+        std::thread reader;
+        std::unique_ptr<TerminalSession> session;
+        std::atomic<bool> running{false};
+        std::atomic<bool> kitty{false};
+
+        /**
+         * @brief Pipe which wakes up the reader thread on stop
+         */
+        int wake[2] = {-1, -1};
+
     public:
         static Keyboard& getInstance(){
             static Keyboard instance;
             return instance;
         }
 
-        ~Keyboard(){}
+        ~Keyboard(){
+            stop();
+        }
+
+        /**
+         * @brief Starts the reader thread
+         * @details Switches the terminal into raw mode and asks it for kitty keyboard
+         *          protocol support. Calling start on a running keyboard does nothing.
+         */
+        void start(){
+            std::lock_guard<std::mutex> lock(mutex);
+            if(running.load()){
+                return;
+            }
+            if(pipe(wake) != 0){
+                return;
+            }
+            session = std::make_unique<TerminalSession>();
+            send("\x1B[?u");
+            running.store(true);
+            reader = std::thread(&Keyboard::run, this, session->fd());
+        }
+
+        /**
+         * @brief Stops the reader thread and restores the terminal
+         */
+        void stop(){
+            std::lock_guard<std::mutex> lock(mutex);
+            if(!running.load()){
+                return;
+            }
+            char byte = 0;
+            ssize_t result = ::write(wake[1], &byte, 1);
+            (void)result;
+            reader.join();
+            close(wake[0]);
+            close(wake[1]);
+            if(kitty.exchange(false)){
+                send("\x1B[<u");
+            }
+            session.reset();
+            running.store(false);
+        }
+
+        /**
+         * @brief Indicates that the reader thread is running
+         */
+        bool isRunning() const{
+            return running.load(std::memory_order_relaxed);
+        }
 
+        /**
+         * @brief Indicates that key releases are reported by the terminal
+         */
+        bool reportsRelease() const{
+            return kitty.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Checks if a key is pressed
+         * @details Returns true while the key is held down (kitty keyboard protocol) or
+         *          if a press was received since the last query of this key.
+         *          The keyboard is started on the first call.
+         * @param key Key to check
+         * @return true If the key is pressed
+         */
         bool keyPressed(keys key){  
-            bool result = false;
-            
-            return result;
+            if(!isRunning()){
+                start();
+            }
+            std::uint8_t state = table[key].fetch_and(static_cast<std::uint8_t>(~PRESS_SEEN), std::memory_order_relaxed);
+            return (state & (DOWN | PRESS_SEEN)) != 0;
         }
 
+        /**
+         * @brief Checks if a key was released
+         * @details If the terminal reports releases this returns true once per release,
+         *          otherwise it is the negation of keyPressed.
+         * @param key Key to check
+         * @return true If the key was released
+         */
         bool keyReleased(keys key){
-            return !keyPressed(key);
+            if(!reportsRelease()){
+                return !keyPressed(key);
+            }
+            std::uint8_t state = table[key].fetch_and(static_cast<std::uint8_t>(~RELEASE_SEEN), std::memory_order_relaxed);
+            return (state & RELEASE_SEEN) != 0;
+        }
+
+        /**
+         * @brief Takes the oldest event out of the queue
+         * @details Never blocks. Events are dropped if the queue is full. Should only be
+         *          called from a single thread.
+         * @param event Event which was taken
+         * @return true If an event was available
+         */
+        bool poll(KeyEvent& event){
+            std::size_t current = tail.load(std::memory_order_relaxed);
+            if(current == head.load(std::memory_order_acquire)){
+                return false;
+            }
+            event = queue[current & (queue_size - 1)];
+            tail.store(current + 1, std::memory_order_release);
+            return true;
         }
 
     private:
 
         Keyboard(){}
 
+        /**
+         * @brief Writes a control sequence to the terminal
+         * @param sequence Sequence which should be written
+         */
+        void send(const char* sequence){
+            int fd = (isatty(STDOUT_FILENO) ? STDOUT_FILENO : session->fd());
+            ssize_t result = ::write(fd, sequence, std::strlen(sequence));
+            (void)result;
+        }
 
+        /**
+         * @brief Reader thread
+         * @param fd File descriptor of the terminal
+         */
+        void run(int fd){
+            KeyDecoder decoder;
+            char buffer[256];
+            struct pollfd descriptors[2] = {{fd, POLLIN, 0}, {wake[0], POLLIN, 0}};
 
-    };
-}
+            while(true){
+                int result = ::poll(descriptors, 2, decoder.pending() ? KeyDecoder::escape_timeout : -1);
+                if(result < 0){
+                    if(errno == EINTR){
+                        continue;
+                    }
+                    return;
+                }
+                if(result == 0){
+                    publish(decoder.flush(), PRESSED);
+                    continue;
+                }
+                if(descriptors[1].revents != 0){
+                    return;
+                }
+
+                ssize_t amount = ::read(fd, buffer, sizeof(buffer));
+                if(amount <= 0){
+                    return;
+                }
+                for(ssize_t i = 0; i < amount; i++){
+                    keys key;
+                    if(!decoder.feed(buffer[i], key)){
+                        continue;
+                    }
+                    if(decoder.kittyReply()){
+                        if(!kitty.exchange(true)){
+                            // Disambiguate escape codes and report event types
+                            send("\x1B[>3u");
+                        }
+                        continue;
+                    }
+                    publish(key, decoder.action());
+                }
+            }
+        }
 
+        /**
+         * @brief Stores an event inside the state table and the queue
+         * @param key Key of the event
+         * @param action Action of the event
+         */
+        void publish(keys key, key_action action){
+            if(key == NONE){
+                return;
+            }
+            if(action == RELEASED){
+                table[key].fetch_and(static_cast<std::uint8_t>(~DOWN), std::memory_order_relaxed);
+                table[key].fetch_or(RELEASE_SEEN, std::memory_order_relaxed);
+            }else if(kitty.load(std::memory_order_relaxed)){
+                table[key].store(DOWN | PRESS_SEEN, std::memory_order_relaxed);
+            }else{
+                table[key].fetch_or(PRESS_SEEN, std::memory_order_relaxed);
+            }
 
+            std::size_t current = head.load(std::memory_order_relaxed);
+            if(current - tail.load(std::memory_order_acquire) == queue_size){
+                return;
+            }
+            queue[current & (queue_size - 1)] = KeyEvent{key, action};
+            head.store(current + 1, std::memory_order_release);
+        }
+    };
+}
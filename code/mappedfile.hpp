@@ -0,0 +1,260 @@
+/**
+ * @file This file contains a list source backed by a memory mapped file
+ * @details This file is licensed under the MIT license. If you decide to use this
+ *          file a copy of the following license must be provided. Giving credit in
+ *          form of a mention inside your source code, documentation or the final
+ *          product would be nice but is not required.
+ *
+ * Example
+ * +-------------------------------------------------------------------+
+ * |  haevn::utils::MappedFileProvider lines("/var/log/hosts.txt");    |
+ * |  if(lines.isOpen()){                                              |
+ * |      haevn::terminal::widgets::Menu menu(lines, txt);             |
+ * |      int line = menu.getSelection();                              |
+ * |  }                                                                |
+ * +-------------------------------------------------------------------+
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Nils Milewski (haevn)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+ * @author Nils Milewski
+ * @version 1.0.0.0
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <thread>
+
+extern "C"{
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+}
+
+#if defined(__SSE2__)
+    #include <immintrin.h>
+#endif
+
+#include "provider.hpp"
+
+namespace haevn::utils{
+
+    /**
+     * @brief This class provides the lines of a memory mapped file
+     * @details The file is mapped read only and a background thread indexes the line ends with
+     *          a vectorised newline scan. Lines are returned as views into the mapping, size()
+     *          grows while the index is built, so widgets become interactive once the first
+     *          lines are indexed. Scanned parts of the mapping are released behind the
+     *          scanner, therefore the resident memory is the index plus the rows which were
+     *          viewed, not the file. A trailing carriage return is not part of a line.
+     */
+    class MappedFileProvider : public EntryProvider{
+    private:
+        /**
+         * @brief Amount of line ends per index chunk
+         */
+        static constexpr std::size_t chunk_lines = 65536;
+
+        /**
+         * @brief Amount of bytes which are scanned before new lines are published
+         */
+        static constexpr std::size_t block_size = 4 << 20;
+
+        int fd = -1;
+        bool open_t = false;
+        const char* data = nullptr;
+        std::size_t length = 0;
+
+        /**
+         * @brief Offsets of the line ends, allocated chunk by chunk so published chunks never move
+         */
+        std::unique_ptr<std::unique_ptr<std::uint64_t[]>[]> chunks;
+        std::size_t chunk_count = 0;
+
+        /**
+         * @brief Amount of indexed lines
+         */
+        std::atomic<std::size_t> lines{0};
+        std::atomic<bool> complete_t{false};
+        std::atomic<bool> stopping{false};
+        std::thread worker;
+
+    public:
+        /**
+         * @brief Construct a new provider and starts indexing the file
+         * @param path Path of the file, check isOpen() afterwards
+         */
+        explicit MappedFileProvider(const char* path){
+            fd = ::open(path, O_RDONLY | O_CLOEXEC);
+            struct stat status;
+            if(fd < 0 || fstat(fd, &status) != 0){
+                complete_t = true;
+                return;
+            }
+            length = status.st_size;
+            // Every byte could end a line, plus an unterminated last line
+            chunk_count = (length + 1) / chunk_lines + 1;
+            chunks = std::make_unique<std::unique_ptr<std::uint64_t[]>[]>(chunk_count);
+            if(length == 0){
+                open_t = true;
+                complete_t = true;
+                return;
+            }
+            void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(mapping == MAP_FAILED){
+                length = 0;
+                complete_t = true;
+                return;
+            }
+            open_t = true;
+            data = static_cast<const char*>(mapping);
+            madvise(mapping, length, MADV_SEQUENTIAL);
+            worker = std::thread(&MappedFileProvider::index, this);
+        }
+
+        ~MappedFileProvider(){
+            stopping = true;
+            if(worker.joinable()){
+                worker.join();
+            }
+            if(data != nullptr){
+                munmap(const_cast<char*>(data), length);
+            }
+            if(fd >= 0){
+                ::close(fd);
+            }
+        }
+
+        MappedFileProvider(const MappedFileProvider&) = delete;
+        MappedFileProvider& operator=(const MappedFileProvider&) = delete;
+
+        /**
+         * @brief Indicates that the file was opened and mapped
+         */
+        bool isOpen() const{
+            return open_t;
+        }
+
+        /**
+         * @brief Gets the amount of indexed lines
+         */
+        std::size_t size() const override{
+            return lines.load(std::memory_order_acquire);
+        }
+
+        std::string_view at(std::size_t index) const override{
+            std::size_t begin = (index > 0 ? end(index - 1) + 1 : 0);
+            std::size_t finish = end(index);
+            if(finish > begin && data[finish - 1] == '\r'){
+                finish--;
+            }
+            return std::string_view(data + begin, finish - begin);
+        }
+
+        bool complete() const override{
+            return complete_t.load(std::memory_order_acquire);
+        }
+
+    private:
+
+        /**
+         * @brief Gets the offset behind a line
+         */
+        std::size_t end(std::size_t index) const{
+            return chunks[index / chunk_lines][index % chunk_lines];
+        }
+
+        /**
+         * @brief Appends a line end, the line is published with the next block
+         */
+        void append(std::size_t& count, std::uint64_t offset){
+            if(count % chunk_lines == 0){
+                chunks[count / chunk_lines] = std::make_unique<std::uint64_t[]>(chunk_lines);
+            }
+            chunks[count / chunk_lines][count % chunk_lines] = offset;
+            count++;
+        }
+
+        /**
+         * @brief Appends every newline between \p first and \p last
+         */
+        void scan(std::size_t& count, std::size_t first, std::size_t last){
+            std::size_t i = first;
+#if defined(__AVX2__)
+            const __m256i newline32 = _mm256_set1_epi8('\n');
+            for(; i + 32 <= last; i += 32){
+                unsigned int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)), newline32));
+                while(mask != 0){
+                    append(count, i + __builtin_ctz(mask));
+                    mask &= mask - 1;
+                }
+            }
+#endif
+#if defined(__SSE2__)
+            const __m128i newline16 = _mm_set1_epi8('\n');
+            for(; i + 16 <= last; i += 16){
+                unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)), newline16));
+                while(mask != 0){
+                    append(count, i + __builtin_ctz(mask));
+                    mask &= mask - 1;
+                }
+            }
+#endif
+            for(; i < last; i++){
+                if(data[i] == '\n'){
+                    append(count, i);
+                }
+            }
+        }
+
+        /**
+         * @brief Index thread
+         */
+        void index(){
+            const std::size_t page = sysconf(_SC_PAGESIZE);
+            std::size_t count = 0;
+            std::size_t released = 0;
+            for(std::size_t position = 0; position < length && !stopping.load(std::memory_order_relaxed); position += block_size){
+                std::size_t last = (position + block_size < length ? position + block_size : length);
+                scan(count, position, last);
+                lines.store(count, std::memory_order_release);
+
+                // Scanned pages are dropped from the resident set, viewed rows fault them in again
+                std::size_t boundary = last / page * page;
+                if(boundary > released){
+                    madvise(const_cast<char*>(data) + released, boundary - released, MADV_DONTNEED);
+                    released = boundary;
+                }
+            }
+            if(!stopping.load(std::memory_order_relaxed) && data[length - 1] != '\n'){
+                append(count, length);
+                lines.store(count, std::memory_order_release);
+            }
+            complete_t.store(true, std::memory_order_release);
+        }
+    };
+}
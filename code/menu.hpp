@@ -52,6 +52,8 @@
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <memory>
+#include <string_view>
 
 extern "C"
 {
@@ -64,7 +66,15 @@ extern "C"
 
 }
 
+#include "colors.hpp"
 #include "utils.hpp"
+#include "keyboard.hpp"
+#include "screen.hpp"
+#include "fuzzy.hpp"
+#include "provider.hpp"
+#include "eventloop.hpp"
+#include "histogram.hpp"
+#include "trace.hpp"
 
 namespace haevn::terminal::widgets{
     
@@ -96,12 +106,12 @@ namespace haevn::terminal::widgets{
         /**
          * @brief Background color
          */
-        const char* background = terminal::colors::background::CYAN;
+        terminal::colors::Style background = terminal::colors::style::background::CYAN;
 
         /**
          * @brief Hightlighting color
          */
-        const char* foreground = terminal::colors::foreground::BLACK;
+        terminal::colors::Style foreground = terminal::colors::style::foreground::BLACK;
 
         /**
          * @brief Row selection indicator
@@ -117,17 +127,75 @@ namespace haevn::terminal::widgets{
          * @brief Navigate DOWN keybind
          */
         char down_key = 's';
+
+        /**
+         * @brief Maximum amount of entries which are displayed at once
+         * @details 0 fits the entries to the terminal height
+         */
+        int visible_rows = 0;
+
+        /**
+         * @brief Enables type to filter
+         * @details Typed characters narrow the entries by fuzzy matching, BACKSPACE removes the
+         *          last character and ESC clears the filter. The entries are ranked by their
+         *          score, therefore only the arrow keys navigate while the filter is enabled.
+         */
+        bool filter = false;
+
+        /**
+         * @brief Color of matched characters
+         */
+        terminal::colors::Style match_highlight = terminal::colors::style::foreground::YELLOW;
+
+        /**
+         * @brief Interval in milliseconds in which a growing provider is redrawn
+         */
+        int refresh_interval = 100;
     };
 
 
     class Menu{
         private:
-            std::vector<std::string>& entries;
+            /**
+             * @brief Provider which is owned by the menu, if it was constructed from a vector
+             */
+            std::unique_ptr<utils::EntryProvider> owned;
+            utils::EntryProvider& entries;
             std::string& message;
             MenuSettings* settings_t;
+            utils::FuzzyFilter filter;
+
+            /**
+             * @brief Matched positions of the printed entry
+             */
+            std::vector<std::size_t> positions;
+
+            /**
+             * @brief State of the running selection
+             */
+            Screen screen;
+            std::string query;
+            int row = 0;
+            int top = 0;
+            int visible = 1;
+            int size = 0;
+            bool filtered = true;
+            std::size_t total = 0;
+            int output_fd = STDOUT_FILENO;
         public:
             Menu(std::vector<std::string>& entries_t, std::string& message_t)
-             : entries(entries_t), message(message_t){
+             : owned(std::make_unique<utils::VectorProvider<std::string>>(entries_t)), entries(*owned), message(message_t){
+                settings_t = new MenuSettings();
+             }
+
+            /**
+             * @brief Construct a new menu which pulls its entries from a provider
+             * @details Only the visible entries are requested, unless the filter is enabled
+             * @param provider Source of the entries, must outlive the menu
+             * @param message_t Header of the menu
+             */
+            Menu(utils::EntryProvider& provider, std::string& message_t)
+             : entries(provider), message(message_t){
                 settings_t = new MenuSettings();
              }
 
@@ -146,6 +214,14 @@ namespace haevn::terminal::widgets{
              *          The result value correspond to the provided entries, e.g. result 0 <=> entries[0]
              *          A known bug is that the input stream is filled after some operation, therefore
              *          setting the settings entry clear_cache is recommended
+             *          Only the entries which fit the terminal are rendered, the selected entry is kept
+             *          visible and PageUp/PageDown/Home/End jump through the list, so a keystroke
+             *          costs O(visible entries) independent of the amount of entries.
+             *          Large lists are filtered in parallel by the shared thread pool, a filter which
+             *          is still running when the next key is typed is cancelled.
+             *          Growing providers, e.g. a StreamProvider reading a pipe, are redrawn every
+             *          refresh_interval while the user selects, keys are read from /dev/tty and the
+             *          menu is drawn there if stdin or stdout are no terminal.
              * @param entries Menu entries which should be printed
              * @param amount_entries Amount of the entries
              * @param menu_header Header of the menu
@@ -153,78 +229,309 @@ namespace haevn::terminal::widgets{
              * @return int Selected 0 based index
             */
             int getSelection(){
-                char c = 'D';
-                int row = settings()->preselected_row;
+                utils::TerminalSession session;
+                start(session);
+                while(true){
+                    refresh(session);
+                    if(handle(utils::KeyDecoder::read(session, timeout()))){
+                        break;
+                    }
+                }
+                return finish();
+            }
+
+#if defined(HAEVN_COROUTINES)
+            /**
+             * @brief Prints a menu on the terminal without blocking the event loop
+             * @details Asynchronous counterpart of getSelection, other tasks of the loop keep
+             *          running while the menu waits for keys
+             * @param loop Event loop which drives the menu
+             * @return utils::Task<int> Selected 0 based index
+             */
+            utils::Task<int> getSelectionAsync(utils::EventLoop& loop){
+                utils::EventLoop::Terminal terminal = co_await loop.terminal();
+                utils::TerminalSession session;
+                start(session);
+                while(true){
+                    refresh(session);
+                    if(handle(co_await terminal.key(session, timeout()))){
+                        break;
+                    }
+                }
+                co_return finish();
+            }
+#endif
+        private:
+            /**
+             * @brief Starts a selection
+             * @param session Session which provides the input
+             */
+            void start(utils::TerminalSession& session){
+                row = settings()->preselected_row;
 
                 if(settings()->clear_cache){
                     char c2;
                     while ((c2 = haevn::utils::Getchar::getch()) != '\n' && c2 != EOF) { }
                 }
 
-                while(true){
-                    std::system("clear");
-                    std::cout << terminal::colors::CLEAR << message << " " << utils::dateTime() << std::endl;
+                // The output is piped, e.g. producer | menu | consumer, the menu is drawn on the terminal
+                FrameBuffer& output = FrameBuffer::standard();
+                output_fd = output.fd();
+                if(!isatty(output_fd) && isatty(session.fd())){
+                    output.fd(session.fd());
+                }
 
-                    std::cout << "Use " << settings()->up_key << "/" << settings()->down_key <<" to navigate and <ENTER> to select" << std::endl;
-                    
-                    if(settings()->sub_header.size() > 0){
-                        std::cout << settings()->sub_header << std::endl;
-                    }
+                size = entries.size();
+                top = 0;
+                visible = 1;
+                query.clear();
+                filtered = true;
+                total = entries.size();
+                if(settings()->filter){
+                    filter.reset();
+                }
+            }
 
-                    std::cout << std::endl;
-                    
-                    for(int i = 0; i < entries.size(); i++){
-                        printEntry(entries.at(i), i, row);
+            /**
+             * @brief Applies a pending filter and draws a frame
+             * @details A key typed meanwhile cancels the filter, no frame is drawn then
+             * @param session Session which provides the input
+             */
+            void refresh(utils::TerminalSession& session){
+                HAEVN_TRACE_SCOPE("menu", "filter");
+                if(!filtered){
+                    if(entries.concurrent()){
+                        filtered = filter.filterInterruptible(entries, query, utils::ThreadPool::shared(), [&session]{ return session.wait(2); });
+                    }else{
+                        filtered = filter.filter(entries, query);
                     }
+                    size = (filter.active() ? filter.matches().size() : entries.size());
+                    row = (row < size ? row : (size > 0 ? size - 1 : 0));
+                }
 
-                    c = utils::Getchar::getch();
+                if(filtered){
+                    draw();
+                }
+            }
+
+            /**
+             * @brief Gets the timeout for the next key
+             * @return int Refresh interval while the provider grows, otherwise -1
+             */
+            int timeout(){
+                return (entries.complete() ? -1 : settings()->refresh_interval);
+            }
 
-                    if(c == settings()->up_key){
-                        row--;
-                        if(row < 0){
-                            row = ((settings()->row_selection_overflow) ? entries.size() - 1 : 0);
+            /**
+             * @brief Applies a key
+             * @param key Key which was typed, NONE if the timeout passed
+             * @return true If the selection is done
+             */
+            bool handle(utils::keys key){
+                HAEVN_TRACE_SCOPE("menu", "handle");
+                if(key == utils::keys::NONE){
+                    // The provider grew meanwhile, only the new entries are matched against the filter
+                    if(entries.size() != total){
+                        total = entries.size();
+                        if(filter.active() && filtered){
+                            filter.extend(entries, (entries.concurrent() ? &utils::ThreadPool::shared() : nullptr));
+                            size = filter.matches().size();
+                        }else if(!filter.active()){
+                            size = total;
                         }
                     }
+                    return false;
+                }
 
-                    if(c == settings()->down_key){
-                        row++;
-                        if(row >= (entries.size())){
-                            row = ((settings()->row_selection_overflow) ? 0 : entries.size() - 1);
-                        }
+                if(settings()->filter){
+                    std::size_t length = query.size();
+                    if(key >= utils::keys::SPACE && key < utils::keys::BACK_SPACE){
+                        query.push_back(static_cast<char>(key));
+                    }else if(key == utils::keys::BACK_SPACE && length > 0){
+                        query.pop_back();
+                    }else if(key == utils::keys::ESC){
+                        query.clear();
                     }
+                    if(query.size() != length || key == utils::keys::ESC){
+                        filtered = false;
+                        row = 0;
+                        top = 0;
+                        return false;
+                    }
+                }
 
-                    if(c == 10){
-                        break;
+                bool up_key = (!settings()->filter && key == settings()->up_key);
+                bool down_key = (!settings()->filter && key == settings()->down_key);
+
+                if(up_key || key == utils::keys::ARROW_UP){
+                    row--;
+                    if(row < 0){
+                        row = ((settings()->row_selection_overflow) ? size - 1 : 0);
+                    }
+                }
+
+                if(down_key || key == utils::keys::ARROW_DOWN){
+                    row++;
+                    if(row >= size){
+                        row = ((settings()->row_selection_overflow) ? 0 : size - 1);
                     }
                 }
 
-                return row;
+                if(key == utils::keys::BILDUP){
+                    row = (row - visible > 0 ? row - visible : 0);
+                }
+
+                if(key == utils::keys::BILDOWN){
+                    row = (row + visible < size ? row + visible : size - 1);
+                }
+
+                if(key == utils::keys::POS){
+                    row = 0;
+                }
+
+                if(key == utils::keys::END){
+                    row = size - 1;
+                }
+
+                return (key == utils::keys::ENTER && filtered && (size > 0 || !settings()->filter));
             }
-        private:   
+
             /**
-             * @brief Prints a menu entry to the terminal
-             * @param message Message to be printed
-             * @param row Row index
-             * @param current_row Current row index
+             * @brief Ends a selection
+             * @return int Selected 0 based index
+             */
+            int finish(){
+                screen.release();
+                utils::PaintLatency::painted();
+                FrameBuffer::standard().fd(output_fd);
+                return (size > 0 ? entryIndex(row) : row);
+            }
+
+            /**
+             * @brief Draws a frame of the menu
+             * @details Adjusts top to keep the selected row visible and visible to the cached terminal size
              */
-            void inline printEntry(std::string message, int row, int current_row){
-                const char* color = settings()->background;
+            void draw(){
+                HAEVN_TRACE_SCOPE("menu", "draw");
+                screen.begin();
+
+                std::string& title = screen.line();
+                title += message;
+                title += ' ';
+                title += utils::dateTime();
 
-                if(row == current_row){
-                    std::cout << color << settings()->foreground << settings()->line_selector[0]; 
+                std::string& help = screen.line();
+                if(settings()->filter){
+                    help += "Type to filter, use the arrow keys to navigate and <ENTER> to select";
                 }else{
-                    std::cout << ' ' << haevn::terminal::colors::RESET;     
+                    help += "Use ";
+                    help += settings()->up_key;
+                    help += '/';
+                    help += settings()->down_key;
+                    help += " to navigate and <ENTER> to select";
+                }
+                
+                if(settings()->sub_header.size() > 0){
+                    screen.line() += settings()->sub_header;
+                }
+
+                if(settings()->filter){
+                    std::string& prompt = screen.line();
+                    prompt += "> ";
+                    prompt += query;
+                    prompt += "  (";
+                    prompt += std::to_string(size);
+                    prompt += '/';
+                    prompt += std::to_string(entries.size());
+                    prompt += ')';
+                }else{
+                    screen.line();
+                }
+
+                utils::TerminalSize terminal = utils::TerminalGeometry::size(FrameBuffer::standard().fd());
+                // Header lines and the scroll indicator
+                int reserved = (settings()->sub_header.size() > 0 ? 5 : 4);
+                visible = (settings()->visible_rows > 0 ? settings()->visible_rows : terminal.rows - reserved);
+                visible = (visible < 1 ? 1 : visible);
+                if(row < top){
+                    top = row;
+                }else if(row >= top + visible){
+                    top = row - visible + 1;
+                }
+                if(top + visible > size){
+                    top = (size > visible ? size - visible : 0);
+                }
+                
+                int bottom = (top + visible < size ? top + visible : size);
+                if(!filter.active()){
+                    entries.prefetch(top, bottom);
+                }
+                for(int i = top; i < bottom; i++){
+                    printEntry(screen.line(), entries[entryIndex(i)], i, row);
                 }
 
-                std::cout << message; 
+                if(size > visible){
+                    std::string& indicator = screen.line();
+                    indicator += (top > 0 ? "^ " : "  ");
+                    indicator += std::to_string(top + 1);
+                    indicator += '-';
+                    indicator += std::to_string(bottom);
+                    indicator += " of ";
+                    indicator += std::to_string(size);
+                    indicator += (bottom < size ? " v" : "  ");
+                }
+
+                utils::PaintLatency::painted(screen.present());
+            }
 
-                if(row == current_row){
-                    std::cout << color << settings()->foreground << settings()->line_selector[1]; 
+            /**
+             * @brief Gets the entry which is displayed in a row
+             * @param row Row index, filtered rows are ordered by score
+             * @return int Index inside entries
+             */
+            int entryIndex(int row){
+                return (filter.active() ? filter.matches()[row].index : row);
+            }
+
+            /**
+             * @brief Prints a menu entry into a screen line
+             * @details Characters which match the filter are highlighted
+             * @param line Line where the entry should be printed
+             * @param message Message to be printed
+             * @param row Row index
+             * @param current_row Current row index
+             */
+            void inline printEntry(std::string& line, std::string_view message, int row, int current_row){
+                terminal::colors::StyleTracker style;
+                terminal::colors::Style normal = (row == current_row ? settings()->background | settings()->foreground : terminal::colors::style::DEFAULT);
+                terminal::colors::Style highlight = normal | settings()->match_highlight;
+
+                style.apply(line, normal);
+                line += (row == current_row ? settings()->line_selector[0] : " ");
+
+                std::int32_t score;
+                const std::string& query = filter.loweredQuery();
+                positions.resize(query.size());
+                if(filter.active() && utils::Fuzzy::match(message, query, score, positions.data())){
+                    // Adjacent matches share one highlight
+                    std::size_t start = 0;
+                    for(std::size_t position : positions){
+                        if(position > start){
+                            style.apply(line, normal);
+                            line.append(message, start, position - start);
+                        }
+                        style.apply(line, highlight);
+                        line += message[position];
+                        start = position + 1;
+                    }
+                    style.apply(line, normal);
+                    line.append(message, start, std::string::npos);
                 }else{
-                    std::cout << ' ';
+                    line += message; 
                 }
 
-                std::cout << haevn::terminal::colors::RESET << std::endl;     
+                line += (row == current_row ? settings()->line_selector[1] : " ");
+                style.reset(line);
             }
     };
 }
\ No newline at end of file
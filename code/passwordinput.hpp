@@ -42,31 +42,114 @@
 #include <string>
 
 #include "utils.hpp"
+#include "framebuffer.hpp"
+#include "keyboard.hpp"
+#include "eventloop.hpp"
+#include "histogram.hpp"
+#include "trace.hpp"
 
 namespace haevn::terminal::widgets{
     /**
      */
     class PasswordInput{
+    private:
+        /**
+         * @brief Password which was typed so far
+         */
+        std::string password;
+
+        /**
+         * @brief Character which is echoed instead of the typed one
+         */
+        char fill_character = ' ';
+
     public:
         PasswordInput(){}
 
-        std::string getPassword(char fill_character = ' '){
-            char c;
-            std::string password;
-            std::cout << "Enter your password: ";
-            while((c = utils::Getchar::getch()) != 10){
-                if(c == 127){
-                    if(password.size() > 0){
-                        std::cout << "\b";
+        /**
+         * @brief Reads a line of password
+         * @details The typed characters are echoed as fill_character_t, a pasted burst is echoed with a single write
+         * @param fill_character_t Character which is echoed instead of the typed one
+         * @return std::string Password without the line break
+         */
+        std::string getPassword(char fill_character_t = ' '){
+            utils::TerminalSession session;
+            fill_character = fill_character_t;
+            start();
+            while(!handle(session, utils::KeyDecoder::read(session))){ }
+            return finish();
+        }
+
+#if defined(HAEVN_COROUTINES)
+        /**
+         * @brief Reads a line of password without blocking the event loop
+         * @details Asynchronous counterpart of getPassword
+         * @param loop Event loop which drives the input
+         * @param fill_character_t Character which is echoed instead of the typed one
+         * @return utils::Task<std::string> Password without the line break
+         */
+        utils::Task<std::string> getPasswordAsync(utils::EventLoop& loop, char fill_character_t = ' '){
+            utils::EventLoop::Terminal terminal = co_await loop.terminal();
+            utils::TerminalSession session;
+            fill_character = fill_character_t;
+            start();
+            while(!handle(session, co_await terminal.key(session))){ }
+            co_return finish();
+        }
+#endif
+
+    private:
+        /**
+         * @brief Prints the prompt
+         */
+        void start(){
+            terminal::FrameBuffer& output = terminal::FrameBuffer::standard();
+            password.clear();
+            output += "Enter your password: ";
+            output.flush();
+        }
+
+        /**
+         * @brief Applies a key
+         * @param session Session which provides the input
+         * @param key Key which was typed
+         * @return true If the line is complete
+         */
+        bool handle(utils::TerminalSession& session, utils::keys key){
+            HAEVN_TRACE_SCOPE("passwordinput", "handle");
+            terminal::FrameBuffer& output = terminal::FrameBuffer::standard();
+            if(key == utils::keys::ENTER){
+                return true;
+            }
+            if(key == utils::keys::BACK_SPACE){
+                if(password.size() > 0){
+                    output += '\b';
                     password.pop_back();
-                    }
-                }else{
-                    password.push_back(c);
-                    std::cout << fill_character;
                 }
+            }else if(key == utils::keys::TAB || (key >= utils::keys::SPACE && key < utils::keys::F1)){
+                // Escape sequences like the arrow keys are decoded and dropped
+                password.push_back(static_cast<char>(key));
+                output += fill_character;
             }
-            std::cout << std::endl;
-            return password;
+            if(session.buffered() == 0){
+                // Echo a pasted burst with a single write
+                bool wrote = !output.empty();
+                output.flush();
+                utils::PaintLatency::painted(wrote);
+            }
+            return false;
+        }
+
+        /**
+         * @brief Ends the line
+         * @return std::string Password which was typed
+         */
+        std::string finish(){
+            terminal::FrameBuffer& output = terminal::FrameBuffer::standard();
+            output += '\n';
+            output.flush();
+            utils::PaintLatency::painted();
+            return std::move(password);
         }
     };
 }
\ No newline at end of file
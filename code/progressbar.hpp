@@ -33,6 +33,10 @@
 
 #include <iostream>
 #include <fstream>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
 
 extern "C"{
     #include <sys/ioctl.h>
@@ -41,6 +45,9 @@ extern "C"{
 }
 
 #include "colors.hpp"
+#include "utils.hpp"
+#include "framebuffer.hpp"
+#include "trace.hpp"
 
 namespace haevn::terminal::widgets{
 
@@ -51,32 +58,32 @@ namespace haevn::terminal::widgets{
  * @version 1.0
  */
 struct ProgressbarSettings{
-    const char* fill_color = colors::background::TRANSPARENT;
+    colors::Style fill_color = colors::style::background::TRANSPARENT;
 
     /**
      * @brief This attribute is the color of the progressbar
      */
-    const char* progress_color = colors::foreground::WHITE;
+    colors::Style progress_color = colors::style::foreground::WHITE;
     
     /**
      * @brief This attribute is the color of finish state
      */
-    const char* done_color = colors::foreground::GREEN;
+    colors::Style done_color = colors::style::foreground::GREEN;
     
     /**
      * @brief This attribute is the color of abort state
      */
-    const char* abort_color = colors::foreground::YELLOW;
+    colors::Style abort_color = colors::style::foreground::YELLOW;
     
     /**
      * @brief This attribute is the color of cancel state
      */
-    const char* cancel_color = colors::foreground::RED;
+    colors::Style cancel_color = colors::style::foreground::RED;
     
     /**
      * @brief This attribute is the color of error state
      */
-    const char* error_color = colors::foreground::RED;
+    colors::Style error_color = colors::style::foreground::RED;
 
     /**
      * @brief This is the total maximum of the progressbar
@@ -90,9 +97,10 @@ struct ProgressbarSettings{
 
     /**
      * @brief this is the possible bar width
-     * @details IMPORTANT Note this attribute should never be changed
+     * @details Default is 0, the bar fills the columns of the terminal which are not used by
+     *          the percentage and the statistics. The size is cached and refreshed on SIGWINCH.
      */
-    const int bar_width = 50;
+    int bar_width = 0;
 
     /**
      * @brief This attribtue is the progress bar fill character
@@ -130,6 +138,131 @@ struct ProgressbarSettings{
      */
     char percentage_end = ')';
 
+    /**
+     * @brief This is the maximum amount of renders per second caused by update
+     * @details The progressbar is only rendered if the displayed state changed and the
+     *          previous render is at least 1/frames_per_second seconds ago.
+     *          0 disables the throttling, default is 30
+     */
+    unsigned int frames_per_second = 30;
+
+    /**
+     * @brief Displays the throughput behind the percentage, e.g. 12.5 kit/s
+     */
+    bool show_rate = false;
+
+    /**
+     * @brief Displays the elapsed time behind the percentage
+     */
+    bool show_elapsed = false;
+
+    /**
+     * @brief Displays the estimated remaining time behind the percentage
+     */
+    bool show_eta = false;
+
+    /**
+     * @brief Unit of a single step, used by the throughput display
+     * @details Default is it, use B for byte based progress
+     */
+    const char* rate_unit = "it";
+
+    /**
+     * @brief Time constant of the throughput average in seconds
+     * @details Samples older than this time constant lose most of their weight, smaller
+     *          values react faster, larger values are smoother. Default is 5 seconds
+     */
+    double rate_time_constant = 5;
+
+};
+
+/**
+ * @brief This class estimates the throughput of a progress
+ * @details The throughput is an exponentially weighted moving average over samples of a
+ *          monotonic clock. The weight of a sample depends on the time since the previous
+ *          sample, so irregular sampling, e.g. throttled rendering, does not bias the average.
+ * @author Nils Milewski
+ * @version 1.0
+ */
+class RateEstimator{
+private:
+    /**
+     * @brief Minimum time in seconds between two samples
+     */
+    static constexpr double minimum_interval = 0.1;
+
+
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point last_sample = started;
+    double last_value = 0;
+    double current_rate = 0;
+    bool has_rate = false;
+
+public:
+
+    /**
+     * @brief Restarts the estimation
+     * @param value Value at the start
+     */
+    void reset(double value = 0){
+        started = std::chrono::steady_clock::now();
+        last_sample = started;
+        last_value = value;
+        current_rate = 0;
+        has_rate = false;
+    }
+
+    /**
+     * @brief Adds a sample
+     * @param value Current value of the progress
+     * @param time_constant Time constant of the average in seconds
+     */
+    void sample(double value, double time_constant){
+        auto now = std::chrono::steady_clock::now();
+        double delta = std::chrono::duration<double>(now - last_sample).count();
+        if(delta < minimum_interval){
+            // Too short intervals are dominated by noise, they are merged into the next sample
+            return;
+        }
+        double rate = (value - last_value) / delta;
+        if(has_rate){
+            double weight = 1 - std::exp(-delta / (time_constant > 0 ? time_constant : 1));
+            current_rate += weight * (rate - current_rate);
+        }else{
+            current_rate = rate;
+            has_rate = true;
+        }
+        last_sample = now;
+        last_value = value;
+    }
+
+    /**
+     * @brief Gets the average throughput
+     * @return double Steps per second, 0 if there is no sample yet
+     */
+    double rate() const{
+        return current_rate;
+    }
+
+    /**
+     * @brief Gets the time since the start
+     * @return double Elapsed seconds
+     */
+    double elapsed() const{
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    }
+
+    /**
+     * @brief Estimates the remaining time
+     * @param remaining Remaining steps
+     * @return double Remaining seconds, negative if the throughput is unknown
+     */
+    double eta(double remaining) const{
+        if(current_rate <= 0){
+            return -1;
+        }
+        return remaining / current_rate;
+    }
 };
 
 /**
@@ -157,7 +290,7 @@ private:
      * @brief The current value of the progressbar
      * @details This attribute should never be manipulated by hand
      */
-    double progress_bar_value;
+    double progress_bar_value = 0;
 
 
     /**
@@ -165,6 +298,31 @@ private:
      * @details If this attribute is true no operation, except reset will be possible
      */
     bool done = false;
+
+    /**
+     * @brief Amount of filled cells of the last render, -1 if nothing was rendered
+     */
+    int rendered_cells = -1;
+
+    /**
+     * @brief Percentage of the last render, -1 if nothing was rendered
+     */
+    int rendered_percentage = -1;
+
+    /**
+     * @brief Time of the last render
+     */
+    std::chrono::steady_clock::time_point last_render;
+
+    /**
+     * @brief Throughput estimation, sampled on every render
+     */
+    RateEstimator estimator;
+
+    /**
+     * @brief Frame buffer where the progressbar is drawn
+     */
+    FrameBuffer* output_t = &FrameBuffer::standard();
  
 public:
     /**
@@ -183,9 +341,21 @@ public:
         return settings_t;
     }
 
+    /**
+     * @brief Sets the frame buffer where the progressbar is drawn
+     * @details Default is FrameBuffer::standard(). A progressbar which is drawn from another
+     *          thread needs a frame buffer of its own, because frame buffers are not thread safe.
+     * @param output Frame buffer, must outlive the progressbar
+     */
+    void output(FrameBuffer& output){
+        output_t = &output;
+    }
+
     /**
      * @brief updates the value
      * @details Updates the progressbar by \p step . Default is 1
+     *          The progressbar is only rendered if the displayed cells or percentage changed
+     *          and the frame rate allows it, therefore calling update in a tight loop is cheap.
      * @param step Step to increment, default 1. If negative the progressbar will rewind
      */
     void update(double step = 1) {
@@ -193,11 +363,7 @@ public:
         if(progress_bar_value >= maximum()){
             finish();
         }else{
-            for(int i = 0; i < 10; ++i){
-                std::cout << settings()->progress_color; 
-                render();
-                std::cout << haevn::terminal::colors::RESET;
-            }
+            refresh();
         }
     }
 
@@ -240,7 +406,7 @@ public:
             value = 0;
         }
         progress_bar_value = value;
-        render();
+        refresh();
     }
 
     /**
@@ -252,9 +418,7 @@ public:
         if(done){
             return;
         }
-        std::cout << settings()->cancel_color;
-        render();
-        std::cout << haevn::terminal::colors::RESET;
+        render(settings()->cancel_color);
         done = true;
     }
 
@@ -268,9 +432,7 @@ public:
         if(done){
             return;
         }
-        std::cout << settings()->abort_color;
-        render();
-        std::cout << haevn::terminal::colors::RESET;
+        render(settings()->abort_color);
         done = true;
     }
 
@@ -283,9 +445,10 @@ public:
         if(done){
             return;
         }
-        std::cout << settings()->done_color;
-        render();
-        std::cout << haevn::terminal::colors::RESET << std::endl;
+        render(settings()->done_color);
+        FrameBuffer& output = *output_t;
+        output += '\n';
+        output.flush();
         done = true;
     }
 
@@ -298,29 +461,210 @@ public:
     void reset(){
         done = false;
         progress_bar_value = 0;
-        render();
+        estimator.reset();
+        render(settings()->progress_color);
+    }
+
+    /**
+     * @brief Gets the throughput
+     * @details The value is an average which is updated whenever the progressbar is rendered
+     * @return double Steps per second
+     */
+    double rate() const{
+        return estimator.rate();
+    }
+
+    /**
+     * @brief Gets the time since the progressbar was created or reset
+     * @return double Elapsed seconds
+     */
+    double elapsed() const{
+        return estimator.elapsed();
+    }
+
+    /**
+     * @brief Estimates the remaining time based on the throughput
+     * @return double Remaining seconds, negative if the throughput is unknown
+     */
+    double eta() const{
+        return estimator.eta(settings_t->maximum - progress_bar_value);
+    }
+
+    /**
+     * @brief Appends a progressbar to a line
+     * @details This is the formatting used by render, it is shared with other widgets
+     *          which draw progressbars, e.g. ProgressGroup
+     * @tparam Output std::string or FrameBuffer
+     * @param line Line where the progressbar should be appended
+     * @param settings Settings which describe the look of the progressbar
+     * @param cells Amount of filled cells
+     * @param width Amount of cells, see width()
+     * @param percentage Percentage which should be displayed
+     * @param color Color of the progressbar
+     */
+    template<typename Output>
+    static void format(Output& line, const ProgressbarSettings& settings, int cells, int width, int percentage, colors::Style color){
+        colors::StyleTracker style;
+        style.apply(line, color | settings.fill_color);
+        line += settings.bar_start;
+        line.append(cells > 0 ? cells : 0, settings.bar_character);
+        line += settings.bar_tail_character;
+        int spaces = width - cells;
+        line.append(spaces > 0 ? spaces : 0, ' ');
+        line += settings.bar_end;
+        style.reset(line);
+        line += ' ';
+        line += settings.percentage_start;
+        line += std::to_string(percentage);
+        line += '%';
+        line += settings.percentage_end;
+    }
+
+    /**
+     * @brief Gets the amount of cells of a progressbar
+     * @details Uses bar_width if it is set, otherwise the bar fills the terminal
+     * @param settings Settings which describe the look of the progressbar
+     * @param reserved Columns which are used in front of the progressbar, e.g. by a label
+     * @return int Amount of cells, at least 10
+     */
+    static int width(const ProgressbarSettings& settings, int reserved = 0){
+        if(settings.bar_width > 0){
+            return settings.bar_width;
+        }
+        // Brackets, tail, percentage and the empty last column
+        reserved += 11;
+        if(settings.show_rate){
+            reserved += 14;
+        }
+        if(settings.show_elapsed){
+            reserved += 9;
+        }
+        if(settings.show_eta){
+            reserved += 13;
+        }
+        int columns = utils::TerminalGeometry::size(FrameBuffer::standard().fd()).columns;
+        return (columns - reserved > 10 ? columns - reserved : 10);
     }
 
 private:
 
+    /**
+     * @brief Gets the amount of filled cells for the current value
+     * @return int Amount of cells
+     */
+    int cells(){
+        return (int)((progress_bar_value / maximum())*(double)width(*settings()));
+    }
+
+    /**
+     * @brief Gets the percentage for the current value
+     * @return int Percentage
+     */
+    int percentage(){
+        return (int)(100*(progress_bar_value / maximum()));
+    }
+
+    /**
+     * @brief This method renders the progressbar if necessary
+     * @details The progressbar is rendered if the displayed state changed and the previous
+     *          render is old enough, see ProgressbarSettings::frames_per_second
+     */
+    void refresh(){
+        if(done){
+            return;
+        }
+        bool statistics = settings()->show_rate || settings()->show_elapsed || settings()->show_eta;
+        if(cells() == rendered_cells && percentage() == rendered_percentage && !statistics){
+            return;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if(cells() == rendered_cells && percentage() == rendered_percentage && now - last_render < std::chrono::seconds(1)){
+            // Statistics are refreshed once per second
+            return;
+        }
+        if(settings()->frames_per_second > 0){
+            if(rendered_cells >= 0 && now - last_render < std::chrono::seconds(1) / settings()->frames_per_second){
+                return;
+            }
+        }
+        render(settings()->progress_color);
+    }
+
     /**
      * @brief This method renders the progressbar
      * @details The method will calculate how wide the progessbar should be rendered.
      *          Later it will override the previous progressbar with a new one based on previous previous calculated width.
+     *          The whole progressbar is written with a single operation.
+     * @param color Color of the progressbar
      */
-    void render(){
-        int amountOfFiller = (int)((progress_bar_value / maximum())*(double)settings()->bar_width);
-
-        std::cout << "\r" << settings()->fill_color << settings()->bar_start;
-        for (int a = 0; a < amountOfFiller; a++) {
-            std::cout << settings()->bar_character;
+    void render(colors::Style color){
+        HAEVN_TRACE_SCOPE("progressbar", "render");
+        int amountOfFiller = cells();
+        rendered_cells = amountOfFiller;
+        rendered_percentage = percentage();
+        last_render = std::chrono::steady_clock::now();
+
+        FrameBuffer& output = *output_t;
+        output += '\r';
+        format(output, *settings(), amountOfFiller, width(*settings()), rendered_percentage, color);
+
+        estimator.sample(progress_bar_value, settings()->rate_time_constant);
+        if(settings()->show_rate){
+            output += ' ';
+            appendRate(output, estimator.rate(), settings()->rate_unit);
         }
-        std::cout << settings()->bar_tail_character;
-        for (int b = 0; b < settings()->bar_width - amountOfFiller; b++) {
-            std::cout << " ";
+        if(settings()->show_elapsed){
+            output += ' ';
+            appendDuration(output, estimator.elapsed());
         }
-        std::cout << settings()->bar_end << colors::RESET << " " << settings()->percentage_start << (int)(100*(progress_bar_value / maximum())) << "%" << settings()->percentage_end << std::flush;
+        if(settings()->show_eta){
+            output += " ETA ";
+            appendDuration(output, eta());
+        }
+        output += "\x1B[K";
 
+        output.flush();
+    }
+
+    /**
+     * @brief Appends a throughput with a metric prefix, e.g. 1.5 MB/s
+     * @param line Line where the throughput should be appended
+     * @param rate Steps per second
+     * @param unit Unit of a step
+     */
+    static void appendRate(FrameBuffer& line, double rate, const char* unit){
+        static const char* prefixes[] = {"", "k", "M", "G", "T"};
+        int prefix = 0;
+        while(rate >= 1000 && prefix < 4){
+            rate /= 1000;
+            prefix++;
+        }
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.1f ", rate);
+        line += buffer;
+        line += prefixes[prefix];
+        line += unit;
+        line += "/s";
+    }
+
+    /**
+     * @brief Appends a duration as MM:SS or HH:MM:SS, unknown durations as --:--
+     * @param line Line where the duration should be appended
+     * @param seconds Duration in seconds
+     */
+    static void appendDuration(FrameBuffer& line, double seconds){
+        if(seconds < 0 || seconds > 359999){
+            line += "--:--";
+            return;
+        }
+        int total = (int)seconds;
+        char buffer[16];
+        if(total >= 3600){
+            std::snprintf(buffer, sizeof(buffer), "%02d:%02d:%02d", total / 3600, (total / 60) % 60, total % 60);
+        }else{
+            std::snprintf(buffer, sizeof(buffer), "%02d:%02d", total / 60, total % 60);
+        }
+        line += buffer;
     }
 };
 
@@ -0,0 +1,400 @@
+/**
+ * @file This file contains a group of progressbars which are drawn as one block
+ * @details This file is licensed under the MIT license. If you decide to use this
+ *          file a copy of the following license must be provided. Giving credit in
+ *          form of a mention inside your source code, documentation or the final
+ *          product would be nice but is not required.
+ *
+ * Example
+ * +--------------------------------------------------+
+ * |  haevn::terminal::widgets::ProgressGroup group;  |
+ * |  group.start();                                  |
+ * |  auto download = group.add("file.tar", size);    |
+ * |  // From the worker of the job                   |
+ * |  download.update(received);                      |
+ * |  download.finish();                              |
+ * |  // Once all jobs are done                       |
+ * |  group.stop();                                   |
+ * +--------------------------------------------------+
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Nils Milewski (haevn)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+ * @author Nils Milewski
+ * @version 1.0.0.0
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "colors.hpp"
+#include "progressbar.hpp"
+#include "screen.hpp"
+#include "reactor.hpp"
+#include "trace.hpp"
+
+namespace haevn::terminal::widgets{
+
+/**
+ * @brief This class contains a group of progressbars
+ * @details Every bar of the group represents one job and is drawn in its own row below the
+ *          current cursor line. If there are more bars than terminal rows, the first bars are
+ *          drawn followed by a row which counts the remaining ones. Rows are only formatted when the displayed state of their bar
+ *          changed and the Screen only rewrites rows which differ from the previous frame, so a
+ *          frame costs one write containing the changed rows. Bars can be added and finished
+ *          from any thread while the group is drawn. Frames are written through a frame buffer
+ *          of the group on the descriptor of FrameBuffer::standard(), so output of other threads
+ *          is not corrupted, but it may interleave with the frames while the group is drawn.
+ *          The group either draws itself with a render thread (start/stop), with a timer of
+ *          a Reactor (start(reactor)/stop) or is drawn by calling render.
+ * @author Nils Milewski
+ * @version 1.0
+ */
+class ProgressGroup{
+private:
+
+    /**
+     * @brief States of a bar
+     */
+    enum bar_state{
+        RUNNING,
+        FINISHED,
+        CANCELED,
+        ABORTED
+    };
+
+    /**
+     * @brief A single bar of the group
+     */
+    struct Bar{
+        std::string label;
+        std::uint64_t maximum;
+        std::atomic<std::uint64_t> value{0};
+        std::atomic<int> state{RUNNING};
+
+        /**
+         * @brief Formatted row and the state it was formatted for
+         */
+        std::string line;
+        int rendered_cells = -1;
+        int rendered_percentage = -1;
+        int rendered_state = -1;
+    };
+
+public:
+
+    /**
+     * @brief This class is a handle to a bar of the group
+     * @details Handles are cheap to copy and stay valid as long as the group exists.
+     */
+    class Handle{
+    private:
+        Bar* bar;
+    public:
+        explicit Handle(Bar* bar_t) : bar(bar_t){}
+
+        /**
+         * @brief updates the value
+         * @details Can be called from any thread, costs one relaxed atomic add
+         * @param step Step to increment, default 1
+         */
+        void update(std::uint64_t step = 1){
+            bar->value.fetch_add(step, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Gets the current value
+         * @return std::uint64_t Current value
+         */
+        std::uint64_t value() const{
+            return bar->value.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Finishes the bar, it will be drawn in green
+         */
+        void finish(){
+            bar->state.store(FINISHED, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Cancels the bar, it will be drawn in yellow
+         */
+        void cancel(){
+            bar->state.store(CANCELED, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Aborts the bar, it will be drawn in red
+         */
+        void abort(){
+            bar->state.store(ABORTED, std::memory_order_relaxed);
+        }
+    };
+
+private:
+
+    ProgressbarSettings* settings_t;
+
+    /**
+     * @brief Bars in the order they were added
+     */
+    std::vector<std::unique_ptr<Bar>> bars;
+
+    /**
+     * @brief Block of rows below the cursor
+     */
+    Screen screen{false};
+
+    /**
+     * @brief Frame buffer of the group, the standard one belongs to the caller thread
+     */
+    FrameBuffer output;
+
+    std::thread renderer;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+
+    /**
+     * @brief Whether the group was started or rendered since the last stop
+     */
+    bool started = false;
+
+    /**
+     * @brief Reactor whose timer draws the group, nullptr if none is used
+     */
+    utils::Reactor* reactor = nullptr;
+    std::uint64_t timer = 0;
+
+    /**
+     * @brief Width of the widest label
+     */
+    std::size_t label_width = 0;
+
+public:
+    ProgressGroup(){
+        settings_t = new ProgressbarSettings();
+    }
+
+    ~ProgressGroup(){
+        stop();
+        delete settings_t;
+    }
+
+    ProgressGroup(const ProgressGroup&) = delete;
+    ProgressGroup& operator=(const ProgressGroup&) = delete;
+
+    /**
+     * @brief Gets the settings shared by all bars
+     * @details Settings should only be changed while the render thread is not running
+     * @return ProgressbarSettings* Settings of the bars
+     */
+    ProgressbarSettings* settings(){
+        return settings_t;
+    }
+
+    /**
+     * @brief Adds a new bar to the group
+     * @details Can be called from any thread, the bar is drawn with the next frame
+     * @param label Text in front of the bar
+     * @param maximum Value at which the bar is complete
+     * @return Handle Handle to update the bar
+     */
+    Handle add(std::string label, std::uint64_t maximum){
+        std::unique_ptr<Bar> bar = std::make_unique<Bar>();
+        bar->label = std::move(label);
+        bar->maximum = (maximum > 0 ? maximum : 1);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if(bar->label.size() > label_width){
+            label_width = bar->label.size();
+            for(std::unique_ptr<Bar>& other : bars){
+                other->rendered_state = -1;
+            }
+        }
+        bars.push_back(std::move(bar));
+        return Handle(bars.back().get());
+    }
+
+    /**
+     * @brief Starts the render thread
+     * @details The thread draws the group with the frame rate of the settings
+     */
+    void start(){
+        std::lock_guard<std::mutex> lock(mutex);
+        if(renderer.joinable()){
+            return;
+        }
+        stopping = false;
+        started = true;
+        output.fd(FrameBuffer::standard().fd());
+        renderer = std::thread(&ProgressGroup::run, this);
+    }
+
+    /**
+     * @brief Draws the group with a timer of a reactor instead of a render thread
+     * @details The group is drawn on the thread of the reactor with the frame rate of the
+     *          settings, timers with the same interval share the wakeup. stop must be
+     *          called on the thread of the reactor.
+     * @param reactor_t Reactor which draws the group, must outlive the drawing
+     */
+    void start(utils::Reactor& reactor_t){
+        std::lock_guard<std::mutex> lock(mutex);
+        if(renderer.joinable() || reactor != nullptr){
+            return;
+        }
+        stopping = false;
+        started = true;
+        output.fd(FrameBuffer::standard().fd());
+        unsigned int fps = settings()->frames_per_second;
+        reactor = &reactor_t;
+        timer = reactor->every(1000 / (fps > 0 && fps < 1000 ? fps : 100), [this]{
+            render();
+        });
+    }
+
+    /**
+     * @brief Stops the render thread
+     * @details Draws the final frame and moves the cursor below the group. Does nothing
+     *          if the group was neither started nor rendered.
+     */
+    void stop(){
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(stopping || !started){
+                return;
+            }
+            stopping = true;
+        }
+        condition.notify_all();
+        if(renderer.joinable()){
+            renderer.join();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if(reactor != nullptr){
+            reactor->cancel(timer);
+            reactor = nullptr;
+        }
+        draw();
+        screen.release(output);
+        started = false;
+        stopping = false;
+    }
+
+    /**
+     * @brief Draws one frame
+     * @details Only needed if the render thread is not used
+     */
+    void render(){
+        std::lock_guard<std::mutex> lock(mutex);
+        if(!started){
+            output.fd(FrameBuffer::standard().fd());
+            started = true;
+        }
+        draw();
+    }
+
+private:
+
+    /**
+     * @brief Render thread
+     */
+    void run(){
+        unsigned int fps = settings()->frames_per_second;
+        auto interval = std::chrono::nanoseconds(std::chrono::seconds(1)) / (fps > 0 ? fps : 100);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while(!stopping){
+            draw();
+            condition.wait_for(lock, interval);
+        }
+    }
+
+    /**
+     * @brief Draws one frame, the mutex must be locked
+     */
+    void draw(){
+        HAEVN_TRACE_SCOPE("progressgroup", "draw");
+        screen.begin();
+        // The cursor can not move above the terminal, so the group never takes all rows
+        std::size_t rows = utils::TerminalGeometry::size(output.fd()).rows;
+        std::size_t available = (rows > 1 ? rows - 1 : 1);
+        std::size_t shown = (bars.size() > available ? available - 1 : bars.size());
+        for(std::size_t i = 0; i < shown; i++){
+            format(*bars[i]);
+            screen.line() += bars[i]->line;
+        }
+        if(shown < bars.size()){
+            std::string& line = screen.line();
+            line += "… ";
+            line += std::to_string(bars.size() - shown);
+            line += " more";
+        }
+        screen.present(output);
+    }
+
+    /**
+     * @brief Formats the row of a bar if its displayed state changed
+     * @param bar Bar which should be formatted
+     */
+    void format(Bar& bar){
+        std::uint64_t value = bar.value.load(std::memory_order_relaxed);
+        if(value > bar.maximum){
+            value = bar.maximum;
+        }
+        int state = bar.state.load(std::memory_order_relaxed);
+        double progress = (double)value / (double)bar.maximum;
+        int width = ProgressBar::width(*settings(), label_width + 1);
+        int cells = (int)(progress * width);
+        int percentage = (int)(100 * progress);
+
+        if(cells == bar.rendered_cells && percentage == bar.rendered_percentage && state == bar.rendered_state){
+            return;
+        }
+        bar.rendered_cells = cells;
+        bar.rendered_percentage = percentage;
+        bar.rendered_state = state;
+
+        colors::Style color = settings()->progress_color;
+        switch(state){
+            case FINISHED: color = settings()->done_color; break;
+            case CANCELED: color = settings()->cancel_color; break;
+            case ABORTED: color = settings()->abort_color; break;
+        }
+
+        bar.line.clear();
+        bar.line += bar.label;
+        bar.line.append(label_width - bar.label.size() + 1, ' ');
+        ProgressBar::format(bar.line, *settings(), cells, width, percentage, color);
+    }
+};
+
+} // ns: haevn::terminal::widgets
@@ -0,0 +1,543 @@
+/**
+ * @file This file contains lazy entry providers for the list widgets
+ * @details This file is licensed under the MIT license. If you decide to use this
+ *          file a copy of the following license must be provided. Giving credit in
+ *          form of a mention inside your source code, documentation or the final
+ *          product would be nice but is not required.
+ *
+ * Example
+ * +---------------------------------------------------------------------------+
+ * |  // Show the names of typed objects without copying them                  |
+ * |  haevn::utils::VectorProvider provider(hosts,                             |
+ * |      [](const Host& host) -> const std::string& { return host.name; });   |
+ * |  haevn::terminal::widgets::Menu menu(provider, txt);                      |
+ * |                                                                           |
+ * |  // Fetch rows of a slow source page by page                              |
+ * |  haevn::utils::PagedProvider paged(count, [](std::size_t first,           |
+ * |      std::size_t amount){ return database.names(first, amount); });       |
+ * |                                                                           |
+ * |  // producer | tool, entries arrive while the menu is shown               |
+ * |  haevn::utils::StreamProvider stream(STDIN_FILENO);                       |
+ * |  haevn::terminal::widgets::Menu menu(stream, txt);                        |
+ * +---------------------------------------------------------------------------+
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Nils Milewski (haevn)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+ * @author Nils Milewski
+ * @version 1.0.0.0
+ */
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+extern "C"{
+    #include <poll.h>
+    #include <unistd.h>
+}
+
+namespace haevn::utils{
+
+    /**
+     * @brief This class describes a source of list entries
+     * @details List widgets only request the entries which are rendered or filtered,
+     *          therefore the entries do not have to be materialised up front.
+     */
+    class EntryProvider{
+    public:
+        virtual ~EntryProvider() = default;
+
+        /**
+         * @brief Gets the amount of entries
+         */
+        virtual std::size_t size() const = 0;
+
+        /**
+         * @brief Gets the text of an entry
+         * @details The view is valid until the next call of at() or prefetch()
+         * @param index Index of the entry
+         * @return std::string_view Text of the entry
+         */
+        virtual std::string_view at(std::size_t index) const = 0;
+
+        /**
+         * @brief Announces that a range of entries will be requested soon
+         * @param first First index of the range
+         * @param last Last index of the range, excluded
+         */
+        virtual void prefetch(std::size_t /*first*/, std::size_t /*last*/){}
+
+        /**
+         * @brief Indicates that size() will not grow anymore
+         * @details Widgets redraw a growing provider periodically
+         */
+        virtual bool complete() const{
+            return true;
+        }
+
+        /**
+         * @brief Indicates that at() can be called by several threads at once
+         * @details Widgets only filter concurrent providers in parallel
+         */
+        virtual bool concurrent() const{
+            return true;
+        }
+
+        std::string_view operator[](std::size_t index) const{
+            return at(index);
+        }
+    };
+
+    /**
+     * @brief Projection which returns the value itself
+     */
+    struct Identity{
+        template<typename T>
+        const T& operator()(const T& value) const{
+            return value;
+        }
+    };
+
+    /**
+     * @brief This class provides the entries of a vector
+     * @details The vector is referenced, not copied. A projection maps an element to its text,
+     *          it must return a reference or view into the element, e.g. a member string.
+     * @tparam T Type of the elements
+     * @tparam Projection Callable mapping const T& to something convertible to std::string_view
+     */
+    template<typename T, typename Projection = Identity>
+    class VectorProvider : public EntryProvider{
+    private:
+        const std::vector<T>& values;
+        Projection projection;
+
+    public:
+        /**
+         * @brief Construct a new vector provider
+         * @param values_t Elements which should be provided
+         * @param projection_t Projection from an element to its text
+         */
+        explicit VectorProvider(const std::vector<T>& values_t, Projection projection_t = Projection())
+         : values(values_t), projection(std::move(projection_t)){}
+
+        std::size_t size() const override{
+            return values.size();
+        }
+
+        std::string_view at(std::size_t index) const override{
+            return std::string_view(projection(values[index]));
+        }
+    };
+
+    /**
+     * @brief This class provides entries of a slow source page by page
+     * @details Pages are loaded by a fetch function and kept inside a least recently used
+     *          cache. prefetch() loads the announced pages and their neighbours on a
+     *          background thread, at() waits for a page which is loading and fetches a
+     *          missing page on the calling thread. Loaded pages only enter the cache inside
+     *          at() and prefetch(), therefore the provider must be used by one thread.
+     */
+    class PagedProvider : public EntryProvider{
+    public:
+        /**
+         * @brief Loads \p amount entries starting at \p first
+         */
+        using Fetch = std::function<std::vector<std::string>(std::size_t first, std::size_t amount)>;
+
+    private:
+        struct Page{
+            std::size_t index;
+            std::vector<std::string> entries;
+        };
+
+        std::size_t length;
+        Fetch fetch;
+        std::size_t page_size;
+        std::size_t cache_pages;
+        std::size_t prefetch_pages;
+
+        /**
+         * @brief Cached pages, the most recently used first
+         */
+        mutable std::list<Page> pages;
+        mutable std::unordered_map<std::size_t, std::list<Page>::iterator> lookup;
+
+        /**
+         * @brief State which is shared with the fetch thread
+         */
+        mutable std::mutex mutex;
+        mutable std::condition_variable condition;
+        mutable std::deque<std::size_t> requested;
+        mutable std::unordered_set<std::size_t> loading;
+        mutable std::vector<Page> loaded;
+        bool stopping = false;
+        std::thread worker;
+
+    public:
+        /**
+         * @brief Construct a new paged provider
+         * @param size Amount of entries
+         * @param fetch_t Function which loads a range of entries, called by the fetch thread
+         *                and by the thread which uses the provider
+         * @param page_size_t Amount of entries per page
+         * @param cache_pages_t Maximum amount of cached pages
+         * @param prefetch_pages_t Amount of pages which are loaded around an announced range
+         */
+        PagedProvider(std::size_t size, Fetch fetch_t, std::size_t page_size_t = 256, std::size_t cache_pages_t = 64, std::size_t prefetch_pages_t = 1)
+         : length(size), fetch(std::move(fetch_t)), page_size(page_size_t > 0 ? page_size_t : 1),
+           cache_pages(cache_pages_t > 2 ? cache_pages_t : 2), prefetch_pages(prefetch_pages_t){
+            worker = std::thread(&PagedProvider::run, this);
+        }
+
+        ~PagedProvider(){
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            condition.notify_all();
+            worker.join();
+        }
+
+        PagedProvider(const PagedProvider&) = delete;
+        PagedProvider& operator=(const PagedProvider&) = delete;
+
+        std::size_t size() const override{
+            return length;
+        }
+
+        std::string_view at(std::size_t index) const override{
+            std::size_t page = index / page_size;
+            const Page& cached = load(page);
+            std::size_t offset = index - page * page_size;
+            if(offset >= cached.entries.size()){
+                return std::string_view();
+            }
+            return cached.entries[offset];
+        }
+
+        void prefetch(std::size_t first, std::size_t last) override{
+            if(first >= last || length == 0){
+                return;
+            }
+            std::size_t first_page = first / page_size;
+            std::size_t last_page = (last - 1) / page_size;
+            first_page = (first_page > prefetch_pages ? first_page - prefetch_pages : 0);
+            last_page = last_page + prefetch_pages;
+            std::size_t pages_total = (length + page_size - 1) / page_size;
+            last_page = (last_page < pages_total ? last_page : pages_total - 1);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                integrate();
+                // Requests which were not started belong to rows which are no longer visible
+                for(std::size_t page : requested){
+                    loading.erase(page);
+                }
+                requested.clear();
+                for(std::size_t page = first_page; page <= last_page; page++){
+                    if(lookup.count(page) == 0 && loading.count(page) == 0){
+                        loading.insert(page);
+                        requested.push_back(page);
+                    }
+                }
+            }
+            condition.notify_all();
+        }
+
+        bool concurrent() const override{
+            return false;
+        }
+
+    private:
+
+        /**
+         * @brief Gets a page from the cache, waits for it or fetches it
+         */
+        const Page& load(std::size_t page) const{
+            auto found = lookup.find(page);
+            if(found == lookup.end()){
+                std::unique_lock<std::mutex> lock(mutex);
+                integrate();
+                found = lookup.find(page);
+                if(found == lookup.end() && loading.count(page) > 0){
+                    condition.wait(lock, [this, page]{ return loading.count(page) == 0; });
+                    integrate();
+                    found = lookup.find(page);
+                }
+            }
+            if(found == lookup.end()){
+                std::size_t first = page * page_size;
+                insert(Page{page, fetch(first, (length - first < page_size ? length - first : page_size))});
+                return pages.front();
+            }
+            pages.splice(pages.begin(), pages, found->second);
+            return pages.front();
+        }
+
+        /**
+         * @brief Moves pages loaded by the fetch thread into the cache, requires the mutex
+         */
+        void integrate() const{
+            for(Page& page : loaded){
+                if(lookup.count(page.index) == 0){
+                    insert(std::move(page));
+                }
+            }
+            loaded.clear();
+        }
+
+        /**
+         * @brief Inserts a page as most recently used and evicts the least recently used page
+         */
+        void insert(Page page) const{
+            pages.push_front(std::move(page));
+            lookup[pages.front().index] = pages.begin();
+            if(pages.size() > cache_pages){
+                lookup.erase(pages.back().index);
+                pages.pop_back();
+            }
+        }
+
+        /**
+         * @brief Fetch thread
+         */
+        void run(){
+            std::unique_lock<std::mutex> lock(mutex);
+            while(true){
+                condition.wait(lock, [this]{ return stopping || !requested.empty(); });
+                if(stopping){
+                    return;
+                }
+                // Newest requests first, they belong to the rows which are visible now
+                std::size_t page = requested.back();
+                requested.pop_back();
+
+                lock.unlock();
+                std::size_t first = page * page_size;
+                std::vector<std::string> entries = fetch(first, (length - first < page_size ? length - first : page_size));
+                lock.lock();
+
+                loaded.push_back(Page{page, std::move(entries)});
+                loading.erase(page);
+                condition.notify_all();
+            }
+        }
+    };
+
+    /**
+     * @brief This class contains a growing, append only list of entries
+     * @details Entries are appended by a producer, either a thread calling append() or a
+     *          reader thread which splits a file descriptor, e.g. a pipe, into lines. The
+     *          texts are copied into large blocks and published in batches, widgets read
+     *          the published entries concurrently without locking and redraw while the
+     *          provider grows. A trailing carriage return is not part of a line.
+     */
+    class StreamProvider : public EntryProvider{
+    private:
+        /**
+         * @brief Amount of entries per index chunk
+         */
+        static constexpr std::size_t chunk_lines = 65536;
+
+        /**
+         * @brief Maximum amount of index chunks, 2^32 entries
+         */
+        static constexpr std::size_t max_chunks = 65536;
+
+        /**
+         * @brief Minimum size of a text block
+         */
+        static constexpr std::size_t block_size = 1 << 20;
+
+        /**
+         * @brief Views of the entries, allocated chunk by chunk so published chunks never move
+         */
+        std::unique_ptr<std::unique_ptr<std::string_view[]>[]> chunks;
+
+        /**
+         * @brief Text blocks, only accessed by the producer
+         */
+        std::vector<std::unique_ptr<char[]>> blocks;
+        std::size_t block_used = 0;
+        std::size_t block_capacity = 0;
+
+        /**
+         * @brief Amount of entries which were appended and published
+         */
+        std::size_t appended = 0;
+        std::atomic<std::size_t> lines{0};
+        std::atomic<bool> complete_t{false};
+
+        std::mutex mutex;
+        std::atomic<bool> stopping{false};
+        std::thread reader;
+
+    public:
+        /**
+         * @brief Construct a new stream which is filled by append()
+         */
+        StreamProvider(){
+            chunks = std::make_unique<std::unique_ptr<std::string_view[]>[]>(max_chunks);
+        }
+
+        /**
+         * @brief Construct a new stream which reads lines from a file descriptor
+         * @details A reader thread appends every line until the end of the input
+         * @param fd File descriptor, e.g. STDIN_FILENO if entries are piped in, not closed
+         */
+        explicit StreamProvider(int fd) : StreamProvider(){
+            reader = std::thread(&StreamProvider::read, this, fd);
+        }
+
+        ~StreamProvider(){
+            stopping = true;
+            if(reader.joinable()){
+                reader.join();
+            }
+        }
+
+        StreamProvider(const StreamProvider&) = delete;
+        StreamProvider& operator=(const StreamProvider&) = delete;
+
+        /**
+         * @brief Appends and publishes an entry
+         * @param text Text of the entry
+         */
+        void append(std::string_view text){
+            std::lock_guard<std::mutex> lock(mutex);
+            store(text);
+            lines.store(appended, std::memory_order_release);
+        }
+
+        /**
+         * @brief Marks the stream as complete, no entry is appended afterwards
+         */
+        void close(){
+            complete_t.store(true, std::memory_order_release);
+        }
+
+        std::size_t size() const override{
+            return lines.load(std::memory_order_acquire);
+        }
+
+        std::string_view at(std::size_t index) const override{
+            return chunks[index / chunk_lines][index % chunk_lines];
+        }
+
+        bool complete() const override{
+            return complete_t.load(std::memory_order_acquire);
+        }
+
+    private:
+
+        /**
+         * @brief Copies an entry into the text blocks, requires the mutex
+         */
+        void store(std::string_view text){
+            if(appended == max_chunks * chunk_lines){
+                return;
+            }
+            if(!text.empty() && text.back() == '\r'){
+                text.remove_suffix(1);
+            }
+            if(block_capacity - block_used < text.size()){
+                block_capacity = (text.size() > block_size ? text.size() : block_size);
+                blocks.push_back(std::make_unique<char[]>(block_capacity));
+                block_used = 0;
+            }
+            char* target = blocks.empty() ? nullptr : blocks.back().get() + block_used;
+            if(!text.empty()){
+                std::memcpy(target, text.data(), text.size());
+            }
+            block_used += text.size();
+
+            if(appended % chunk_lines == 0){
+                chunks[appended / chunk_lines] = std::make_unique<std::string_view[]>(chunk_lines);
+            }
+            chunks[appended / chunk_lines][appended % chunk_lines] = std::string_view(target, text.size());
+            appended++;
+        }
+
+        /**
+         * @brief Reader thread, every read is published as one batch
+         */
+        void read(int fd){
+            std::vector<char> buffer(65536);
+            std::string partial;
+            struct pollfd descriptor = {fd, POLLIN, 0};
+            while(!stopping.load(std::memory_order_relaxed)){
+                // The timeout lets the destructor stop a reader which waits for a slow producer
+                int ready = poll(&descriptor, 1, 100);
+                if(ready == 0 || (ready < 0 && errno == EINTR)){
+                    continue;
+                }
+                ssize_t amount = (ready > 0 ? ::read(fd, buffer.data(), buffer.size()) : -1);
+                if(amount < 0 && (errno == EINTR || errno == EAGAIN)){
+                    continue;
+                }
+                if(amount <= 0){
+                    break;
+                }
+
+                std::lock_guard<std::mutex> lock(mutex);
+                const char* begin = buffer.data();
+                const char* end = begin + amount;
+                while(begin < end){
+                    const char* newline = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+                    if(newline == nullptr){
+                        partial.append(begin, end);
+                        break;
+                    }
+                    if(partial.empty()){
+                        store(std::string_view(begin, newline - begin));
+                    }else{
+                        partial.append(begin, newline);
+                        store(partial);
+                        partial.clear();
+                    }
+                    begin = newline + 1;
+                }
+                lines.store(appended, std::memory_order_release);
+            }
+            if(!partial.empty()){
+                append(partial);
+            }
+            close();
+        }
+    };
+}
@@ -0,0 +1,414 @@
+/**
+ * @file This file contains a driver which runs widgets on a pseudo terminal
+ * @details This file is licensed under the MIT license. If you decide to use this
+ *          file a copy of the following license must be provided. Giving credit in
+ *          form of a mention inside your source code, documentation or the final
+ *          product would be nice but is not required.
+ *
+ * Example
+ * +--------------------------------------------------------------------+
+ * |  haevn::utils::PtyDriver driver;                                   |
+ * |  std::vector<std::string> script(10000, "\x1B[B");                 |
+ * |  script.push_back("\r");                                           |
+ * |  haevn::utils::PtyDriver::Result result = driver.run([&]{           |
+ * |      return menu.getSelection();                                   |
+ * |  }, script);                                                       |
+ * |  std::cout << result.value << ' ' << result.output.size();        |
+ * +--------------------------------------------------------------------+
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Nils Milewski (haevn)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+ * @author Nils Milewski
+ * @version 1.0.0.0
+ */
+#pragma once
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+extern "C"{
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <signal.h>
+    #include <stdlib.h>
+    #include <sys/ioctl.h>
+    #include <sys/wait.h>
+    #include <termios.h>
+    #include <unistd.h>
+}
+
+#include "framebuffer.hpp"
+
+namespace haevn::utils{
+
+    struct PtyDriverSettings{
+        /**
+         * @brief Size of the pseudo terminal
+         */
+        unsigned short rows = 24;
+        unsigned short columns = 80;
+
+        /**
+         * @brief Time in milliseconds the widget may take for its first frame
+         */
+        int startup_timeout = 2000;
+
+        /**
+         * @brief Time in milliseconds a step may take until output arrives
+         * @details Steps which do not change the frame produce no output, they cost the whole timeout
+         */
+        int step_timeout = 1000;
+
+        /**
+         * @brief Time in milliseconds the widget may take to return after the script
+         */
+        int exit_timeout = 2000;
+    };
+
+    /**
+     * @brief This class runs a widget on a pseudo terminal and feeds it a key script
+     * @details The widget runs in a forked child whose stdin, stdout and stderr are the
+     *          slave of a new pseudo terminal, so it reads, draws and switches modes exactly
+     *          like on a real terminal. The driver writes one step of the script, e.g. a key
+     *          or a pasted burst, waits for the first byte of the resulting frame and records
+     *          the latency and the amount of bytes. The whole output and the value returned
+     *          by the widget are captured.
+     *          The child is forked from the calling thread, create the driver before the
+     *          shared thread pool or other threads are started in the parent.
+     */
+    class PtyDriver{
+    public:
+        struct Result{
+            /**
+             * @brief Value returned by the widget, converted to a string, e.g. "3" or "1,4,5"
+             */
+            std::string value;
+
+            /**
+             * @brief Every byte the widget wrote
+             */
+            std::string output;
+
+            /**
+             * @brief Time from writing a step until its first output byte, -1 if nothing arrived
+             */
+            std::vector<std::chrono::nanoseconds> latencies;
+
+            /**
+             * @brief Bytes written in response to a step
+             */
+            std::vector<std::size_t> bytes;
+
+            /**
+             * @brief Frames and write syscalls of FrameBuffer::standard() inside the child
+             */
+            std::uint64_t frames = 0;
+            std::uint64_t syscalls = 0;
+
+            /**
+             * @brief Indicates that the widget returned before exit_timeout
+             */
+            bool finished = false;
+
+            /**
+             * @brief Status of the child as reported by waitpid
+             */
+            int status = 0;
+        };
+
+    private:
+        PtyDriverSettings settings_t;
+
+    public:
+        PtyDriver(){}
+
+        explicit PtyDriver(const PtyDriverSettings& settings) : settings_t(settings){}
+
+        PtyDriverSettings* settings(){
+            return &settings_t;
+        }
+
+        /**
+         * @brief Runs a widget and feeds it a key script
+         * @tparam Widget Callable which runs the widget and returns its value
+         * @param widget Widget call, e.g. [&]{ return menu.getSelection(); }
+         * @param script Steps which are written one after another, e.g. "\x1B[B" or a pasted text
+         * @return Result Captured output, value and measurements
+         */
+        template<typename Widget>
+        Result run(Widget widget, const std::vector<std::string>& script){
+            Result result;
+            int master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+            if(master < 0 || grantpt(master) != 0 || unlockpt(master) != 0){
+                if(master >= 0){
+                    close(master);
+                }
+                return result;
+            }
+            char name[128];
+            int slave = (ptsname_r(master, name, sizeof(name)) == 0 ? open(name, O_RDWR | O_NOCTTY) : -1);
+            int channel[2];
+            if(slave < 0 || pipe2(channel, O_CLOEXEC) != 0){
+                close(master);
+                if(slave >= 0){
+                    close(slave);
+                }
+                return result;
+            }
+
+            fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+            struct winsize window = {settings_t.rows, settings_t.columns, 0, 0};
+            ioctl(master, TIOCSWINSZ, &window);
+            // Keys written before the widget enters raw mode would otherwise be echoed
+            struct termios mode;
+            if(tcgetattr(slave, &mode) == 0){
+                mode.c_lflag &= ~(ICANON | ECHO);
+                tcsetattr(slave, TCSANOW, &mode);
+            }
+
+            std::cout.flush();
+            terminal::FrameBuffer::standard().flush();
+            pid_t child = fork();
+            if(child == 0){
+                close(master);
+                close(channel[0]);
+                setsid();
+                ioctl(slave, TIOCSCTTY, 0);
+                dup2(slave, STDIN_FILENO);
+                dup2(slave, STDOUT_FILENO);
+                dup2(slave, STDERR_FILENO);
+                if(slave > STDERR_FILENO){
+                    close(slave);
+                }
+                int code = 0;
+                std::string report;
+                try{
+                    if constexpr(std::is_void_v<decltype(widget())>){
+                        widget();
+                    }else{
+                        report = text(widget());
+                    }
+                }catch(...){
+                    code = 1;
+                }
+                std::cout.flush();
+                terminal::FrameBuffer& output = terminal::FrameBuffer::standard();
+                output.flush();
+                std::string message = std::to_string(output.statistics().frames) + ' ' + std::to_string(output.statistics().syscalls) + '\n' + report;
+                std::size_t written = 0;
+                while(written < message.size()){
+                    ssize_t amount = ::write(channel[1], message.data() + written, message.size() - written);
+                    if(amount <= 0){
+                        break;
+                    }
+                    written += amount;
+                }
+                _exit(code);
+            }
+            close(slave);
+            close(channel[1]);
+            if(child < 0){
+                close(master);
+                close(channel[0]);
+                return result;
+            }
+
+            std::string message;
+            Pump pump{master, channel[0], result.output, message};
+            pump.wait(settings_t.startup_timeout);
+            pump.drain();
+
+            for(const std::string& step : script){
+                pump.drain();
+                std::size_t before = result.output.size();
+                auto start = std::chrono::steady_clock::now();
+                pump.write(step);
+                if(pump.wait(settings_t.step_timeout)){
+                    result.latencies.push_back(std::chrono::steady_clock::now() - start);
+                }else{
+                    result.latencies.push_back(std::chrono::nanoseconds(-1));
+                }
+                pump.drain();
+                result.bytes.push_back(result.output.size() - before);
+            }
+
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(settings_t.exit_timeout);
+            while(pump.open() && std::chrono::steady_clock::now() < deadline){
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+                pump.wait(static_cast<int>(left.count()) + 1);
+            }
+            if(pump.open()){
+                kill(child, SIGKILL);
+            }
+            waitpid(child, &result.status, 0);
+            close(master);
+            close(channel[0]);
+
+            result.finished = (!pump.open() && WIFEXITED(result.status) && WEXITSTATUS(result.status) == 0);
+            std::size_t line = message.find('\n');
+            if(result.finished && line != std::string::npos){
+                std::istringstream counters(message.substr(0, line));
+                counters >> result.frames >> result.syscalls;
+                result.value = message.substr(line + 1);
+            }
+            return result;
+        }
+
+    private:
+
+        /**
+         * @brief Reads the output of the terminal and the report of the child
+         */
+        struct Pump{
+            int master;
+            int channel;
+            std::string& output;
+            std::string& message;
+            bool terminal_open = true;
+            bool channel_open = true;
+
+            /**
+             * @brief Waits for output and reads everything which is available
+             * @param timeout_ms Timeout in milliseconds
+             * @return true If terminal output was read
+             */
+            bool wait(int timeout_ms){
+                auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+                while(open()){
+                    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+                    struct pollfd descriptors[2] = {{(terminal_open ? master : -1), POLLIN, 0}, {(channel_open ? channel : -1), POLLIN, 0}};
+                    int ready = poll(descriptors, 2, (left > 0 ? static_cast<int>(left) : 0));
+                    if(ready < 0 && errno == EINTR){
+                        continue;
+                    }
+                    if(ready <= 0){
+                        return false;
+                    }
+                    readChannel(descriptors[1].revents);
+                    if(descriptors[0].revents != 0 && readTerminal()){
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            /**
+             * @brief Writes input while reading the output
+             * @details A large burst fills the terminal buffer, the widget can only consume it
+             *          if its output is read meanwhile
+             * @param data Bytes which should be written
+             */
+            void write(const std::string& data){
+                std::size_t written = 0;
+                while(written < data.size() && terminal_open){
+                    ssize_t amount = ::write(master, data.data() + written, data.size() - written);
+                    if(amount > 0){
+                        written += amount;
+                        continue;
+                    }
+                    if(amount < 0 && errno != EINTR && errno != EAGAIN){
+                        return;
+                    }
+                    struct pollfd descriptor = {master, POLLIN | POLLOUT, 0};
+                    if(poll(&descriptor, 1, -1) > 0 && (descriptor.revents & POLLIN)){
+                        readTerminal();
+                    }
+                }
+            }
+
+            /**
+             * @brief Reads everything which is available without waiting
+             */
+            void drain(){
+                while(terminal_open){
+                    struct pollfd descriptor = {master, POLLIN, 0};
+                    if(poll(&descriptor, 1, 0) <= 0 || !readTerminal()){
+                        return;
+                    }
+                }
+            }
+
+            /**
+             * @brief Indicates that the child may still write
+             */
+            bool open() const{
+                return terminal_open || channel_open;
+            }
+
+            bool readTerminal(){
+                char buffer[65536];
+                ssize_t amount = ::read(master, buffer, sizeof(buffer));
+                if(amount > 0){
+                    output.append(buffer, amount);
+                    return true;
+                }
+                if(amount == 0 || (errno != EINTR && errno != EAGAIN)){
+                    // EIO once the child closed the slave
+                    terminal_open = false;
+                }
+                return false;
+            }
+
+            void readChannel(short events){
+                if(events == 0){
+                    return;
+                }
+                char buffer[4096];
+                ssize_t amount = ::read(channel, buffer, sizeof(buffer));
+                if(amount > 0){
+                    message.append(buffer, amount);
+                }else if(amount == 0 || errno != EINTR){
+                    channel_open = false;
+                }
+            }
+        };
+
+        /**
+         * @brief Converts the value of a widget to a string
+         */
+        template<typename T>
+        static std::string text(const T& value){
+            if constexpr(std::is_same_v<T, std::string>){
+                return value;
+            }else if constexpr(std::is_arithmetic_v<T>){
+                return std::to_string(value);
+            }else{
+                std::string joined;
+                for(const auto& element : value){
+                    if(!joined.empty()){
+                        joined += ',';
+                    }
+                    joined += std::to_string(element);
+                }
+                return joined;
+            }
+        }
+    };
+}
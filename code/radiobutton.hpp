@@ -44,9 +44,20 @@
  */
 #pragma once
 
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "colors.hpp"
+#include "utils.hpp"
+#include "keyboard.hpp"
+#include "screen.hpp"
+#include "provider.hpp"
+#include "eventloop.hpp"
+#include "histogram.hpp"
+#include "trace.hpp"
+
 namespace haevn::terminal::widgets{
 
     struct RadioButtonEntry{
@@ -78,12 +89,12 @@ namespace haevn::terminal::widgets{
         /**
          * @brief Background color
          */
-        const char* background = terminal::colors::background::CYAN;
+        terminal::colors::Style background = terminal::colors::style::background::CYAN;
 
         /**
          * @brief Hightlighting color
          */
-        const char* foreground = terminal::colors::foreground::BLACK;
+        terminal::colors::Style foreground = terminal::colors::style::foreground::BLACK;
 
         /**
          * @brief Row selection indicator
@@ -99,17 +110,91 @@ namespace haevn::terminal::widgets{
          * @brief Navigate DOWN keybind
          */
         char down_key = 's';
+
+        /**
+         * @brief Checks the preselected row when the widget starts
+         */
+        bool preselected_checked = false;
+
+        /**
+         * @brief Maximum amount of entries which are displayed at once
+         * @details 0 fits the entries to the terminal height
+         */
+        int visible_rows = 0;
+
+        /**
+         * @brief Interval in milliseconds in which a growing provider is redrawn
+         */
+        int refresh_interval = 100;
     };
 
     class RadioButton{
     private:
-            std::vector<RadioButtonEntry>& entries;
+            /**
+             * @brief Entries of a vector based radio button, nullptr for a provider based one
+             */
+            std::vector<RadioButtonEntry>* entries;
+
+            /**
+             * @brief Provider which is owned by the radio button, if it was constructed from a vector
+             */
+            std::unique_ptr<utils::EntryProvider> owned;
+
+            /**
+             * @brief Texts of the entries
+             */
+            utils::EntryProvider& texts;
             std::string& message;
             RadioButtonSettings* settings_t;
+
+            /**
+             * @brief Index of the checked entry, -1 if no entry is checked
+             */
+            int checked_t = -1;
+
+            /**
+             * @brief State of the running selection
+             */
+            Screen screen;
+            int row = 0;
+            int top = 0;
+            int visible = 1;
+            int size = 0;
+
+            /**
+             * @brief Projection from an entry to its text
+             */
+            struct Text{
+                const std::string& operator()(const RadioButtonEntry& entry) const{
+                    return entry.text;
+                }
+            };
     
     public:
+        /**
+         * @brief Construct a new radio button
+         * @details The first selected entry is checked, further selected entries are unchecked
+         */
         RadioButton(std::vector<RadioButtonEntry>& entries_t, std::string& message_t)
-             : entries(entries_t), message(message_t){
+             : entries(&entries_t), owned(std::make_unique<utils::VectorProvider<RadioButtonEntry, Text>>(entries_t)), texts(*owned), message(message_t){
+            settings_t = new RadioButtonSettings();
+            for(std::size_t i = 0; i < entries_t.size(); i++){
+                if(entries_t[i].selected && checked_t < 0){
+                    checked_t = i;
+                }else{
+                    entries_t[i].selected = false;
+                }
+            }
+        }
+
+        /**
+         * @brief Construct a new radio button which pulls its texts from a provider
+         * @details No entry is checked initially, use preselected_checked to seed it
+         * @param provider Source of the texts, must outlive the radio button
+         * @param message_t Header of the radio button
+         */
+        RadioButton(utils::EntryProvider& provider, std::string& message_t)
+             : entries(nullptr), texts(provider), message(message_t){
             settings_t = new RadioButtonSettings();
         }
 
@@ -120,78 +205,230 @@ namespace haevn::terminal::widgets{
         RadioButtonSettings* settings(){
             return settings_t;
         }
+
+        /**
+         * @brief Gets the index of the checked entry
+         * @return int Index of the checked entry, -1 if no entry is checked
+         */
+        int checked() const{
+            return checked_t;
+        }
         
-        void selectItems(){
-            char c = 'D';
-            int row = settings()->preselected_row;
+        /**
+         * @brief Prints the radio buttons on the terminal
+         * @details The checked entry is tracked by index, so checking an entry costs O(1).
+         *          Only the entries which fit the terminal are rendered.
+         * @return int Index of the checked entry, -1 if no entry is checked
+         */
+        int selectItems(){
+            utils::TerminalSession session;
+            start();
+            while(true){
+                draw();
+                if(handle(utils::KeyDecoder::read(session, timeout()))){
+                    break;
+                }
+            }
+            return finish();
+        }
+
+#if defined(HAEVN_COROUTINES)
+        /**
+         * @brief Prints the radio buttons on the terminal without blocking the event loop
+         * @details Asynchronous counterpart of selectItems, other tasks of the loop keep
+         *          running while the radio buttons wait for keys
+         * @param loop Event loop which drives the radio buttons
+         * @return utils::Task<int> Index of the checked entry, -1 if no entry is checked
+         */
+        utils::Task<int> selectItemsAsync(utils::EventLoop& loop){
+            utils::EventLoop::Terminal terminal = co_await loop.terminal();
+            utils::TerminalSession session;
+            start();
+            while(true){
+                draw();
+                if(handle(co_await terminal.key(session, timeout()))){
+                    break;
+                }
+            }
+            co_return finish();
+        }
+#endif
+        
+    private:
+
+        /**
+         * @brief Starts a selection
+         */
+        void start(){
+            row = settings()->preselected_row;
+            size = texts.size();
 
             if(settings()->clear_cache){
                 char c2;
                 while ((c2 = haevn::utils::Getchar::getch()) != '\n' && c2 != EOF) { }
             }
 
-            while(true){
-                std::system("clear");
-                std::cout << terminal::colors::CLEAR << message << " " << utils::dateTime() << std::endl;
+            if(settings()->preselected_checked && row >= 0 && row < size){
+                check(row);
+            }
 
-                std::cout << "Use " << settings()->up_key << "/" << settings()->down_key <<" to navigate, <ENTER> to check/uncheck and q to return" << std::endl;
-                    
-                if(settings()->sub_header.size() > 0){
-                    std::cout << settings()->sub_header << std::endl;
-                }
+            top = 0;
+            visible = 1;
+        }
 
-                std::cout << std::endl;
-                    
-                for(int i = 0; i < entries.size(); i++){
-                    printEntry(entries.at(i).text, i, row);
-                }
+        /**
+         * @brief Draws a frame of the radio buttons
+         * @details Adjusts top to keep the selected row visible and visible to the cached terminal size
+         */
+        void draw(){
+            HAEVN_TRACE_SCOPE("radiobutton", "draw");
+            screen.begin();
 
-                c = utils::Getchar::getch();
+            std::string& title = screen.line();
+            title += message;
+            title += ' ';
+            title += utils::dateTime();
 
-                if(c == settings()->up_key){
-                    row--;
-                    if(row < 0){
-                        row = ((settings()->row_selection_overflow) ? entries.size() - 1 : 0);
-                    }
-                }
+            std::string& help = screen.line();
+            help += "Use ";
+            help += settings()->up_key;
+            help += '/';
+            help += settings()->down_key;
+            help += " to navigate, <ENTER> to check/uncheck and q to return";
+                
+            if(settings()->sub_header.size() > 0){
+                screen.line() += settings()->sub_header;
+            }
 
-                if(c == settings()->down_key){
-                    row++;
-                    if(row >= (entries.size())){
-                        row = ((settings()->row_selection_overflow) ? 0 : entries.size() - 1);
-                    }
-                }
+            screen.line();
+
+            utils::TerminalSize terminal = utils::TerminalGeometry::size(FrameBuffer::standard().fd());
+            // Header lines and the scroll indicator
+            int reserved = (settings()->sub_header.size() > 0 ? 5 : 4);
+            visible = (settings()->visible_rows > 0 ? settings()->visible_rows : terminal.rows - reserved);
+            visible = (visible < 1 ? 1 : visible);
+            if(row < top){
+                top = row;
+            }else if(row >= top + visible){
+                top = row - visible + 1;
+            }
+            if(top + visible > size){
+                top = (size > visible ? size - visible : 0);
+            }
+
+            int bottom = (top + visible < size ? top + visible : size);
+            texts.prefetch(top, bottom);
+            for(int i = top; i < bottom; i++){
+                printEntry(screen.line(), texts[i], i, row);
+            }
+
+            if(size > visible){
+                std::string& indicator = screen.line();
+                indicator += (top > 0 ? "^ " : "  ");
+                indicator += std::to_string(top + 1);
+                indicator += '-';
+                indicator += std::to_string(bottom);
+                indicator += " of ";
+                indicator += std::to_string(size);
+                indicator += (bottom < size ? " v" : "  ");
+            }
+
+            utils::PaintLatency::painted(screen.present());
+        }
+
+        /**
+         * @brief Gets the timeout for the next key
+         * @return int Refresh interval while the provider grows, otherwise -1
+         */
+        int timeout(){
+            return (texts.complete() ? -1 : settings()->refresh_interval);
+        }
+
+        /**
+         * @brief Applies a key
+         * @param key Key which was typed, NONE if the timeout passed
+         * @return true If the radio buttons should return
+         */
+        bool handle(utils::keys key){
+            HAEVN_TRACE_SCOPE("radiobutton", "handle");
+            if(key == utils::keys::NONE){
+                // The provider grew meanwhile
+                size = texts.size();
+                return false;
+            }
 
-                if(c == 10){
-                    check(row);   
+            if(key == settings()->up_key || key == utils::keys::ARROW_UP){
+                row--;
+                if(row < 0){
+                    row = ((settings()->row_selection_overflow) ? size - 1 : 0);
                 }
-                if(c == 'q'){
-                    break;
+            }
+
+            if(key == settings()->down_key || key == utils::keys::ARROW_DOWN){
+                row++;
+                if(row >= size){
+                    row = ((settings()->row_selection_overflow) ? 0 : size - 1);
                 }
             }
+
+            if(key == utils::keys::BILDUP){
+                row = (row - visible > 0 ? row - visible : 0);
+            }
+
+            if(key == utils::keys::BILDOWN){
+                row = (row + visible < size ? row + visible : size - 1);
+            }
+
+            if(key == utils::keys::POS){
+                row = 0;
+            }
+
+            if(key == utils::keys::END){
+                row = size - 1;
+            }
+
+            if(key == utils::keys::ENTER && size > 0){
+                check(row);   
+            }
+            return (key == utils::keys::LOWER_Q);
         }
-        
-    private:
-        
+
+        /**
+         * @brief Ends a selection
+         * @return int Index of the checked entry, -1 if no entry is checked
+         */
+        int finish(){
+            screen.release();
+            utils::PaintLatency::painted();
+            return checked_t;
+        }
+
+        /**
+         * @brief Checks an entry and unchecks the previous one
+         * @param index Index of the entry
+         */
         void check(int index){
-            for(int i = 0; i < entries.size(); i++){
-                entries.at(i).selected = false;
+            if(entries != nullptr){
+                if(checked_t >= 0 && checked_t < static_cast<int>(entries->size())){
+                    (*entries)[checked_t].selected = false;
+                }
+                entries->at(index).selected = true;
             }
-            entries.at(index).selected = true;
+            checked_t = index;
         }
 
-        void inline printEntry(std::string message, int row, int current_row){
-            const char* color = settings()->background;
-
+        void inline printEntry(std::string& line, std::string_view message, int row, int current_row){
+            terminal::colors::StyleTracker style;
             if(row == current_row){
-                std::cout << color << settings()->foreground << '[' << (entries.at(row).selected ? "•" : " ") << ']'; 
-            }else{
-                std::cout << '[' << (entries.at(row).selected ? "•" : " ") << ']';     
+                style.apply(line, settings()->background | settings()->foreground);
             }
+            line += '[';
+            line += (row == checked_t ? "•" : " ");
+            line += ']';
 
-            std::cout << message; 
+            line += message; 
 
-            std::cout << haevn::terminal::colors::RESET << std::endl;     
+            style.reset(line);
         }
 
     };
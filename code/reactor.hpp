@@ -0,0 +1,503 @@
+/**
+ * @file This file contains an epoll based reactor for terminal applications
+ * @details This file is licensed under the MIT license. If you decide to use this
+ *          file a copy of the following license must be provided. Giving credit in
+ *          form of a mention inside your source code, documentation or the final
+ *          product would be nice but is not required.
+ *
+ * Example
+ * +--------------------------------------------------------------------+
+ * |  haevn::utils::TerminalSession session;                            |
+ * |  haevn::utils::Reactor reactor;                                    |
+ * |  reactor.onKey(session, [&](haevn::utils::keys key){               |
+ * |      if(key == haevn::utils::keys::LOWER_Q){ reactor.stop(); }     |
+ * |  });                                                               |
+ * |  reactor.onResize([&](haevn::utils::TerminalSize size){ ... });    |
+ * |  reactor.onSignal(SIGTERM, [&](int){ reactor.stop(); });           |
+ * |  reactor.every(100, [&]{ spinner.update(); });                     |
+ * |  reactor.run();                                                    |
+ * +--------------------------------------------------------------------+
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Nils Milewski (haevn)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+ * @author Nils Milewski
+ * @version 1.0.0.0
+ */
+#pragma once
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+extern "C"{
+    #include <signal.h>
+    #include <pthread.h>
+    #include <sys/epoll.h>
+    #include <sys/signalfd.h>
+    #include <sys/timerfd.h>
+    #include <unistd.h>
+}
+
+#include "utils.hpp"
+#include "keyboard.hpp"
+
+namespace haevn::utils{
+
+    /**
+     * @brief This class contains an epoll based reactor
+     * @details The reactor multiplexes the terminal input, signals, timers and descriptors
+     *          of the caller on one epoll instance and dispatches them to callbacks.
+     *          Signals are received through a signalfd and timers share a single timerfd
+     *          which is only armed while timers exist, therefore an idle reactor sleeps
+     *          inside epoll_wait. Timers live on a timer wheel with a resolution of
+     *          tick_ms, repeating timers are aligned to multiples of their interval so
+     *          spinners, clocks and progress bars are repainted within the same wakeup.
+     *          Callbacks may watch, unwatch, schedule and cancel from inside the reactor.
+     *          The reactor is single threaded, signals handled by the reactor are blocked
+     *          for the calling thread, create it before starting other threads.
+     */
+    class Reactor{
+    public:
+        /**
+         * @brief Callback of a descriptor, receives the epoll events
+         */
+        using Handler = std::function<void(std::uint32_t)>;
+
+        /**
+         * @brief Callback of a signal, receives the signal number
+         */
+        using SignalHandler = std::function<void(int)>;
+
+        /**
+         * @brief Callback of a timer
+         */
+        using Callback = std::function<void()>;
+
+        /**
+         * @brief Resolution of the timers in milliseconds
+         */
+        static constexpr int tick_ms = 10;
+
+        /**
+         * @brief Amount of slots of the timer wheel
+         */
+        static constexpr std::size_t wheel_size = 256;
+
+    private:
+        static constexpr std::int64_t tick_ns = 1000000LL * tick_ms;
+
+        struct Timer{
+            std::uint64_t expiry;
+            std::uint64_t interval;
+            Callback callback;
+            bool cancelled = false;
+        };
+
+        int epoll_fd;
+        int timer_fd;
+        int signal_fd = -1;
+
+        /**
+         * @brief Signals which are received through signal_fd
+         */
+        sigset_t signals;
+
+        /**
+         * @brief Signal mask of the thread before the first signal was handled
+         */
+        sigset_t previous_mask;
+
+        std::unordered_map<int, std::shared_ptr<Handler>> handlers;
+        std::unordered_map<int, SignalHandler> signal_handlers;
+
+        /**
+         * @brief Living timers, cancelled timers are removed from the wheel lazily
+         */
+        std::unordered_map<std::uint64_t, std::shared_ptr<Timer>> timers;
+
+        /**
+         * @brief Timer ids by expiry tick modulo wheel_size
+         */
+        std::array<std::vector<std::uint64_t>, wheel_size> wheel;
+
+        std::uint64_t next_id = 1;
+
+        /**
+         * @brief Last tick whose timers were processed
+         */
+        std::uint64_t current = 0;
+
+        /**
+         * @brief Tick for which the timerfd is armed, 0 if it is disarmed
+         */
+        std::uint64_t armed = 0;
+
+        /**
+         * @brief Point in time of tick 0
+         */
+        struct timespec origin;
+
+        bool running = false;
+
+    public:
+        Reactor(){
+            epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+            timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+            clock_gettime(CLOCK_MONOTONIC, &origin);
+            sigemptyset(&signals);
+            pthread_sigmask(SIG_BLOCK, nullptr, &previous_mask);
+            watch(timer_fd, EPOLLIN, [this](std::uint32_t){
+                std::uint64_t expirations;
+                while(::read(timer_fd, &expirations, sizeof(expirations)) > 0){ }
+                expire();
+            });
+        }
+
+        ~Reactor(){
+            if(signal_fd >= 0){
+                close(signal_fd);
+                pthread_sigmask(SIG_SETMASK, &previous_mask, nullptr);
+            }
+            close(timer_fd);
+            close(epoll_fd);
+        }
+
+        Reactor(const Reactor&) = delete;
+        Reactor& operator=(const Reactor&) = delete;
+
+        /**
+         * @brief Watches a descriptor
+         * @details A descriptor which is already watched gets the new events and handler
+         * @param fd File descriptor
+         * @param events Epoll events, e.g. EPOLLIN
+         * @param handler Callback which receives the ready events
+         * @return true If the descriptor could be added
+         */
+        bool watch(int fd, std::uint32_t events, Handler handler){
+            struct epoll_event event = {};
+            event.events = events;
+            event.data.fd = fd;
+            bool known = (handlers.find(fd) != handlers.end());
+            if(epoll_ctl(epoll_fd, (known ? EPOLL_CTL_MOD : EPOLL_CTL_ADD), fd, &event) != 0){
+                return false;
+            }
+            handlers[fd] = std::make_shared<Handler>(std::move(handler));
+            return true;
+        }
+
+        /**
+         * @brief Stops watching a descriptor
+         * @param fd File descriptor
+         */
+        void unwatch(int fd){
+            if(handlers.erase(fd) > 0){
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+            }
+        }
+
+        /**
+         * @brief Decodes the input of a session and dispatches the keys
+         * @details Pasted bursts are dispatched key by key, a hung up terminal is unwatched
+         * @param session Session which provides the input, must outlive the watch
+         * @param handler Callback which receives the keys
+         */
+        void onKey(TerminalSession& session, std::function<void(keys)> handler){
+            int fd = session.fd();
+            watch(fd, EPOLLIN, [this, &session, fd, handler = std::move(handler)](std::uint32_t events){
+                do{
+                    keys key = KeyDecoder::read(session, 0);
+                    if(key == NONE){
+                        if(session.buffered() == 0 && (events & (EPOLLHUP | EPOLLERR))){
+                            unwatch(fd);
+                            return;
+                        }
+                        break;
+                    }
+                    handler(key);
+                }while(session.buffered() > 0);
+            });
+        }
+
+        /**
+         * @brief Handles a signal inside the reactor
+         * @details The signal is blocked and received through a signalfd, its previous
+         *          disposition is bypassed until the reactor is destroyed
+         * @param signal Signal number, e.g. SIGINT
+         * @param handler Callback which receives the signal number
+         * @return true If the signal could be added
+         */
+        bool onSignal(int signal, SignalHandler handler){
+            sigset_t added;
+            sigemptyset(&added);
+            sigaddset(&added, signal);
+            sigaddset(&signals, signal);
+            if(pthread_sigmask(SIG_BLOCK, &added, nullptr) != 0){
+                return false;
+            }
+            int fd = signalfd(signal_fd, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+            if(fd < 0){
+                return false;
+            }
+            if(signal_fd < 0){
+                signal_fd = fd;
+                watch(signal_fd, EPOLLIN, [this](std::uint32_t){
+                    struct signalfd_siginfo info;
+                    while(::read(signal_fd, &info, sizeof(info)) == sizeof(info)){
+                        if(info.ssi_signo == SIGWINCH){
+                            // The handler of TerminalGeometry does not run while SIGWINCH is blocked
+                            TerminalGeometry::invalidate();
+                        }
+                        auto found = signal_handlers.find(static_cast<int>(info.ssi_signo));
+                        if(found != signal_handlers.end()){
+                            SignalHandler handler = found->second;
+                            handler(static_cast<int>(info.ssi_signo));
+                        }
+                    }
+                });
+            }
+            signal_handlers[signal] = std::move(handler);
+            return true;
+        }
+
+        /**
+         * @brief Handles SIGWINCH inside the reactor
+         * @param handler Callback which receives the new terminal size
+         * @return true If the signal could be added
+         */
+        bool onResize(std::function<void(TerminalSize)> handler){
+            return onSignal(SIGWINCH, [handler = std::move(handler)](int){
+                handler(TerminalGeometry::size());
+            });
+        }
+
+        /**
+         * @brief Calls a callback once after a delay
+         * @param delay_ms Delay in milliseconds, the expiry is rounded up to the next tick
+         *                 so the callback never runs early
+         * @param callback Callback which is called
+         * @return std::uint64_t Id of the timer
+         */
+        std::uint64_t after(int delay_ms, Callback callback){
+            std::int64_t expiry = elapsed() + static_cast<std::int64_t>(delay_ms > 0 ? delay_ms : 0) * 1000000LL;
+            std::uint64_t tick = static_cast<std::uint64_t>((expiry + tick_ns - 1) / tick_ns);
+            std::uint64_t current_tick = now();
+            return schedule(tick > current_tick ? tick : current_tick + 1, 0, std::move(callback));
+        }
+
+        /**
+         * @brief Calls a callback repeatedly
+         * @details Timers with the same interval expire on the same tick, missed expirations
+         *          are skipped
+         * @param interval_ms Interval in milliseconds, rounded up to tick_ms
+         * @param callback Callback which is called
+         * @return std::uint64_t Id of the timer
+         */
+        std::uint64_t every(int interval_ms, Callback callback){
+            std::uint64_t interval = (interval_ms > tick_ms ? (interval_ms + tick_ms - 1) / tick_ms : 1);
+            return schedule(align(now(), interval), interval, std::move(callback));
+        }
+
+        /**
+         * @brief Cancels a timer
+         * @param id Id of the timer, unknown ids are ignored
+         */
+        void cancel(std::uint64_t id){
+            auto found = timers.find(id);
+            if(found != timers.end()){
+                found->second->cancelled = true;
+                timers.erase(found);
+            }
+        }
+
+        /**
+         * @brief Waits once for events and dispatches them
+         * @param timeout_ms Timeout in milliseconds, negative values wait forever
+         * @return false If waiting failed
+         */
+        bool runOnce(int timeout_ms = -1){
+            struct epoll_event events[64];
+            int amount = epoll_wait(epoll_fd, events, 64, timeout_ms);
+            if(amount < 0){
+                return (errno == EINTR);
+            }
+            for(int i = 0; i < amount; i++){
+                auto found = handlers.find(events[i].data.fd);
+                if(found == handlers.end()){
+                    // Unwatched by an earlier callback
+                    continue;
+                }
+                std::shared_ptr<Handler> handler = found->second;
+                (*handler)(events[i].events);
+            }
+            return true;
+        }
+
+        /**
+         * @brief Dispatches events until stop is called
+         */
+        void run(){
+            running = true;
+            while(running && runOnce()){ }
+        }
+
+        /**
+         * @brief Lets run return after the current dispatch
+         */
+        void stop(){
+            running = false;
+        }
+
+    private:
+
+        /**
+         * @brief Gets the current tick
+         * @return std::uint64_t Ticks since the construction
+         */
+        std::uint64_t now() const{
+            return static_cast<std::uint64_t>(elapsed() / tick_ns);
+        }
+
+        /**
+         * @brief Gets the time since the construction
+         * @return std::int64_t Nanoseconds since the construction
+         */
+        std::int64_t elapsed() const{
+            struct timespec time;
+            clock_gettime(CLOCK_MONOTONIC, &time);
+            return (time.tv_sec - origin.tv_sec) * 1000000000LL + (time.tv_nsec - origin.tv_nsec);
+        }
+
+        /**
+         * @brief Gets the next multiple of an interval
+         * @param tick Current tick
+         * @param interval Interval in ticks
+         * @return std::uint64_t First multiple of interval after tick
+         */
+        static std::uint64_t align(std::uint64_t tick, std::uint64_t interval){
+            return (tick / interval + 1) * interval;
+        }
+
+        std::uint64_t schedule(std::uint64_t expiry, std::uint64_t interval, Callback callback){
+            std::uint64_t id = next_id++;
+            timers[id] = std::make_shared<Timer>(Timer{expiry, interval, std::move(callback)});
+            wheel[expiry % wheel_size].push_back(id);
+            if(armed == 0 || expiry < armed){
+                arm(expiry);
+            }
+            return id;
+        }
+
+        /**
+         * @brief Calls the expired timers and arms the timerfd for the next one
+         */
+        void expire(){
+            std::uint64_t tick = now();
+            std::vector<std::shared_ptr<Timer>> due;
+            // A single revolution visits every slot, even after a long stall
+            std::uint64_t last = (tick - current < wheel_size ? tick : current + wheel_size);
+            for(std::uint64_t t = current + 1; t <= last; t++){
+                std::vector<std::uint64_t>& slot = wheel[t % wheel_size];
+                std::size_t kept = 0;
+                for(std::uint64_t id : slot){
+                    auto found = timers.find(id);
+                    if(found == timers.end()){
+                        continue;
+                    }
+                    if(found->second->expiry > tick){
+                        slot[kept++] = id;
+                        continue;
+                    }
+                    due.push_back(found->second);
+                    if(found->second->interval > 0){
+                        found->second->expiry = align(tick, found->second->interval);
+                        if(found->second->expiry % wheel_size == t % wheel_size){
+                            slot[kept++] = id;
+                        }else{
+                            wheel[found->second->expiry % wheel_size].push_back(id);
+                        }
+                    }else{
+                        timers.erase(found);
+                    }
+                }
+                slot.resize(kept);
+            }
+            current = tick;
+
+            for(const std::shared_ptr<Timer>& timer : due){
+                // Cancelled by an earlier callback of the same wakeup
+                if(!timer->cancelled){
+                    timer->callback();
+                }
+            }
+
+            arm(next());
+        }
+
+        /**
+         * @brief Finds the earliest expiry
+         * @return std::uint64_t Tick of the earliest timer, 0 if no timer exists
+         */
+        std::uint64_t next() const{
+            if(timers.empty()){
+                return 0;
+            }
+            for(std::uint64_t t = current + 1; t <= current + wheel_size; t++){
+                for(std::uint64_t id : wheel[t % wheel_size]){
+                    auto found = timers.find(id);
+                    if(found != timers.end() && found->second->expiry == t){
+                        return t;
+                    }
+                }
+            }
+            std::uint64_t earliest = timers.begin()->second->expiry;
+            for(const auto& timer : timers){
+                earliest = (timer.second->expiry < earliest ? timer.second->expiry : earliest);
+            }
+            return earliest;
+        }
+
+        /**
+         * @brief Arms the timerfd for a tick
+         * @param tick Absolute tick, 0 disarms the timerfd
+         */
+        void arm(std::uint64_t tick){
+            struct itimerspec spec = {};
+            if(tick > 0){
+                std::uint64_t milliseconds = tick * tick_ms;
+                spec.it_value.tv_sec = origin.tv_sec + milliseconds / 1000;
+                spec.it_value.tv_nsec = origin.tv_nsec + (milliseconds % 1000) * 1000000;
+                if(spec.it_value.tv_nsec >= 1000000000){
+                    spec.it_value.tv_sec++;
+                    spec.it_value.tv_nsec -= 1000000000;
+                }
+            }
+            timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr);
+            armed = tick;
+        }
+    };
+}
@@ -0,0 +1,285 @@
+/**
+ * @file This file contains a diffing screen model used by the interactive widgets
+ * @details This file is licensed under the MIT license. If you decide to use this
+ *          file a copy of the following license must be provided. Giving credit in
+ *          form of a mention inside your source code, documentation or the final
+ *          product would be nice but is not required.
+ *
+ * Example
+ * +--------------------------------------------------------------------+
+ * |  haevn::terminal::Screen screen;                                   |
+ * |  screen.begin();                                                   |
+ * |  screen.line() += "Hello";                                         |
+ * |  screen.line() += "World";                                         |
+ * |  screen.present();                                                 |
+ * |  screen.release();                                                 |
+ * +--------------------------------------------------------------------+
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Nils Milewski (haevn)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+ * @author Nils Milewski
+ * @version 1.0.0.0
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include "colors.hpp"
+#include "utils.hpp"
+#include "framebuffer.hpp"
+#include "trace.hpp"
+
+namespace haevn::terminal{
+
+    /**
+     * @brief This class contains a diffing screen model
+     * @details Widgets describe every frame line by line. The screen keeps the previous
+     *          frame and only rewrites the lines which changed since the last present,
+     *          therefore moving the selection of a menu costs two line rewrites.
+     *          The cursor is moved relative to the first line of the frame, so the same
+     *          model works for fullscreen widgets (the first frame clears the terminal)
+     *          and for inline blocks inside the scrollback.
+     */
+    class Screen{
+    private:
+        /**
+         * @brief Lines of the frame which is visible on the terminal
+         */
+        std::vector<std::string> previous;
+
+        /**
+         * @brief Lines of the frame which is currently build
+         */
+        std::vector<std::string> current;
+
+        /**
+         * @brief Amount of used lines inside previous
+         */
+        std::size_t previous_lines = 0;
+
+        /**
+         * @brief Amount of used lines inside current
+         */
+        std::size_t current_lines = 0;
+
+        /**
+         * @brief Amount of terminal rows which belong to the screen
+         */
+        std::size_t rows_on_screen = 1;
+
+        /**
+         * @brief Row of the cursor relative to the first line of the frame
+         */
+        std::size_t cursor_row = 0;
+
+        /**
+         * @brief Columns of the terminal during the last present
+         */
+        std::size_t previous_columns = 0;
+
+        /**
+         * @brief Indicates that the next present must repaint everything
+         */
+        bool fresh = true;
+
+        /**
+         * @brief Clears the terminal before the first frame
+         */
+        bool fullscreen;
+
+    public:
+        /**
+         * @brief Construct a new screen
+         * @param fullscreen_t If true the terminal is cleared before the first frame,
+         *                     otherwise the frame starts at the current cursor line
+         */
+        explicit Screen(bool fullscreen_t = true) : fullscreen(fullscreen_t){}
+
+        /**
+         * @brief Starts a new frame
+         * @details All lines added afterwards describe the new frame.
+         */
+        void begin(){
+            current_lines = 0;
+        }
+
+        /**
+         * @brief Appends a new empty line to the current frame
+         * @details The returned string is owned by the screen and reused for later frames,
+         *          it is only valid until the next call of begin().
+         * @return std::string& Line which should be filled by the caller
+         */
+        std::string& line(){
+            if(current_lines == current.size()){
+                current.emplace_back();
+            }
+            std::string& result = current[current_lines++];
+            result.clear();
+            return result;
+        }
+
+        /**
+         * @brief Forces a full repaint on the next present
+         */
+        void invalidate(){
+            fresh = true;
+        }
+
+        /**
+         * @brief Writes the difference between the previous and the current frame
+         * @details Only changed lines are rewritten, lines which are no longer used are erased.
+         *          Lines wider than the terminal are clipped, so they never wrap and scroll
+         *          the frame. The whole difference is flushed with a single write of \p output.
+         *          The cursor stays behind the last rewritten line.
+         * @param output Frame buffer where the frame should be drawn, default FrameBuffer::standard()
+         * @return true If anything was written, false if the frame did not change
+         */
+        bool present(FrameBuffer& output = FrameBuffer::standard()){
+            HAEVN_TRACE_SCOPE("screen", "present");
+            if(fresh){
+                if(fullscreen){
+                    output += colors::CLEAR;
+                }
+                previous_lines = 0;
+                rows_on_screen = 1;
+                cursor_row = 0;
+                fresh = false;
+            }
+
+            // The last column is left empty, erasing from it would remove the last character
+            std::size_t columns = utils::TerminalGeometry::size(output.fd()).columns - 1;
+            // Clipped lines are rewritten after a resize
+            bool resized = (columns != previous_columns);
+            previous_columns = columns;
+            for(std::size_t i = 0; i < current_lines; i++){
+                if(!resized && i < previous_lines && previous[i] == current[i]){
+                    continue;
+                }
+                moveTo(output, i);
+                std::size_t length = clip(current[i], columns);
+                if(length < current[i].size()){
+                    output.append(current[i].data(), length);
+                    output += colors::RESET;
+                }else{
+                    output += current[i];
+                }
+                output += "\x1B[K";
+            }
+
+            if(current_lines < previous_lines){
+                moveTo(output, current_lines);
+                output += "\x1B[J";
+            }
+
+            previous.swap(current);
+            previous_lines = current_lines;
+
+            bool wrote = !output.empty();
+            output.flush();
+            return wrote;
+        }
+
+        /**
+         * @brief Moves the cursor below the last line of the frame
+         * @details Should be called once a widget is done, so following output does not
+         *          overwrite the frame. The next present starts a new frame.
+         * @param output Frame buffer where the frame was drawn, default FrameBuffer::standard()
+         */
+        void release(FrameBuffer& output = FrameBuffer::standard()){
+            if(previous_lines > 0){
+                moveTo(output, previous_lines - 1);
+            }
+            output += "\r\n";
+            output.flush();
+            fresh = true;
+        }
+
+    private:
+
+        /**
+         * @brief Gets the length of the part of a line which fits into the terminal
+         * @details Escape sequences take no columns, every UTF-8 character takes one column
+         * @param line Line which should be printed
+         * @param columns Amount of available columns
+         * @return std::size_t Amount of bytes which fit
+         */
+        static std::size_t clip(const std::string& line, std::size_t columns){
+            std::size_t used = 0;
+            std::size_t i = 0;
+            while(i < line.size()){
+                unsigned char byte = static_cast<unsigned char>(line[i]);
+                if(byte == '\x1B'){
+                    i++;
+                    if(i < line.size() && line[i] == '['){
+                        // CSI sequence, ends with a byte between @ and ~
+                        i++;
+                        while(i < line.size() && (line[i] < '@' || line[i] > '~')){
+                            i++;
+                        }
+                    }
+                    i++;
+                    continue;
+                }
+                if((byte & 0xC0) != 0x80){
+                    if(used == columns){
+                        return i;
+                    }
+                    used++;
+                }
+                i++;
+            }
+            return line.size();
+        }
+
+        /**
+         * @brief Appends the escape sequences which move the cursor to the start of a row
+         * @details Rows which do not exist on the terminal yet are created with new lines
+         * @param output Frame buffer where the sequences are appended
+         * @param row Target row relative to the first line of the frame
+         */
+        void moveTo(FrameBuffer& output, std::size_t row){
+            if(row < cursor_row){
+                output += "\x1B[";
+                output += std::to_string(cursor_row - row);
+                output += 'A';
+            }else if(row > cursor_row){
+                std::size_t existing = (row < rows_on_screen ? row : rows_on_screen - 1);
+                if(existing > cursor_row){
+                    output += "\x1B[";
+                    output += std::to_string(existing - cursor_row);
+                    output += 'B';
+                }
+                for(std::size_t i = existing; i < row; i++){
+                    output += '\n';
+                }
+                if(row >= rows_on_screen){
+                    rows_on_screen = row + 1;
+                }
+            }
+            output += '\r';
+            cursor_row = row;
+        }
+    };
+}
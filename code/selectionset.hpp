@@ -0,0 +1,286 @@
+/**
+ * @file This file contains a compact selection set
+ * @details This file is licensed under the MIT license. If you decide to use this
+ *          file a copy of the following license must be provided. Giving credit in
+ *          form of a mention inside your source code, documentation or the final
+ *          product would be nice but is not required.
+ *
+ * Example
+ * +-----------------------------------------------------------------+
+ * |  haevn::utils::SelectionSet selection(entries.size());          |
+ * |  selection.selectAll();                                         |
+ * |  selection.set(3, false);                                       |
+ * |  std::vector<std::uint32_t> indices = selection.indices();      |
+ * +-----------------------------------------------------------------+
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Nils Milewski (haevn)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+ * @author Nils Milewski
+ * @version 1.0.0.0
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace haevn::utils{
+
+    /**
+     * @brief This class contains a compact set of selected indices
+     * @details Every index is stored as one bit which is interpreted relative to an inverted
+     *          flag, so selecting or deselecting everything only clears the bits and inverting
+     *          only flips the flag. The amount of selected indices is maintained on every
+     *          change, ranges are written word by word.
+     */
+    class SelectionSet{
+    private:
+        static constexpr std::size_t word_bits = 64;
+
+        /**
+         * @brief Bits which differ from the inverted flag
+         */
+        std::vector<std::uint64_t> words;
+
+        /**
+         * @brief Amount of indices
+         */
+        std::size_t length = 0;
+
+        /**
+         * @brief Amount of set bits inside words
+         */
+        std::size_t bits = 0;
+
+        /**
+         * @brief Indicates that a cleared bit means selected
+         */
+        bool inverted = false;
+
+    public:
+        /**
+         * @brief Construct a new selection set
+         * @param size Amount of indices, none is selected
+         */
+        explicit SelectionSet(std::size_t size = 0){
+            resize(size);
+        }
+
+        /**
+         * @brief Gets the amount of indices
+         */
+        std::size_t size() const{
+            return length;
+        }
+
+        /**
+         * @brief Changes the amount of indices
+         * @details New indices are not selected, costs one pass over the bits
+         * @param size New amount of indices
+         */
+        void resize(std::size_t size){
+            if(inverted){
+                // Cleared bits would select the new indices
+                for(std::uint64_t& word : words){
+                    word = ~word;
+                }
+                if(!words.empty()){
+                    words.back() &= tailMask();
+                }
+                inverted = false;
+            }
+            length = size;
+            words.resize((size + word_bits - 1) / word_bits, 0);
+            if(!words.empty()){
+                words.back() &= tailMask();
+            }
+            bits = 0;
+            for(std::uint64_t word : words){
+                bits += __builtin_popcountll(word);
+            }
+        }
+
+        /**
+         * @brief Gets the amount of selected indices
+         */
+        std::size_t count() const{
+            return (inverted ? length - bits : bits);
+        }
+
+        /**
+         * @brief Indicates that an index is selected
+         */
+        bool selected(std::size_t index) const{
+            return ((words[index / word_bits] & bit(index)) != 0) != inverted;
+        }
+
+        /**
+         * @brief Selects or deselects an index
+         * @param index Index which should be changed
+         * @param value New state
+         */
+        void set(std::size_t index, bool value){
+            assign(index, value != inverted);
+        }
+
+        /**
+         * @brief Toggles an index
+         */
+        void toggle(std::size_t index){
+            assign(index, (words[index / word_bits] & bit(index)) == 0);
+        }
+
+        /**
+         * @brief Selects every index
+         */
+        void selectAll(){
+            reset(true);
+        }
+
+        /**
+         * @brief Deselects every index
+         */
+        void clear(){
+            reset(false);
+        }
+
+        /**
+         * @brief Inverts every index in O(1)
+         */
+        void invert(){
+            inverted = !inverted;
+        }
+
+        /**
+         * @brief Selects or deselects a range
+         * @param first First index of the range
+         * @param last Last index of the range, included
+         * @param value New state
+         */
+        void setRange(std::size_t first, std::size_t last, bool value){
+            if(first > last){
+                std::size_t swap = first;
+                first = last;
+                last = swap;
+            }
+            bool raw = (value != inverted);
+            std::size_t end = last + 1;
+            while(first < end){
+                std::size_t word = first / word_bits;
+                std::size_t offset = first % word_bits;
+                std::size_t amount = (end - first < word_bits - offset ? end - first : word_bits - offset);
+                std::uint64_t mask = (amount == word_bits ? ~std::uint64_t(0) : ((std::uint64_t(1) << amount) - 1) << offset);
+                std::uint64_t previous = words[word];
+                words[word] = (raw ? previous | mask : previous & ~mask);
+                bits += __builtin_popcountll(words[word]);
+                bits -= __builtin_popcountll(previous);
+                first += amount;
+            }
+        }
+
+        /**
+         * @brief Selects or deselects a list of indices
+         * @tparam Indices Iterable range, its elements are indices or provide an index member
+         * @param indices Indices which should be changed, e.g. the matches of a FuzzyFilter
+         * @param value New state
+         */
+        template<typename Indices>
+        void setAll(const Indices& indices, bool value){
+            for(const auto& element : indices){
+                set(indexOf(element), value);
+            }
+        }
+
+        /**
+         * @brief Gets the selected indices
+         * @return std::vector<std::uint32_t> Ascending selected indices
+         */
+        std::vector<std::uint32_t> indices() const{
+            std::vector<std::uint32_t> result;
+            result.reserve(count());
+            std::uint64_t flip = (inverted ? ~std::uint64_t(0) : 0);
+            for(std::size_t i = 0; i < words.size(); i++){
+                std::uint64_t word = words[i] ^ flip;
+                if(i + 1 == words.size()){
+                    // Bits behind the last index are never set
+                    word &= tailMask();
+                }
+                while(word != 0){
+                    result.push_back(static_cast<std::uint32_t>(i * word_bits + __builtin_ctzll(word)));
+                    word &= word - 1;
+                }
+            }
+            return result;
+        }
+
+    private:
+
+        static std::uint64_t bit(std::size_t index){
+            return std::uint64_t(1) << (index % word_bits);
+        }
+
+        /**
+         * @brief Mask of the valid bits inside the last word
+         */
+        std::uint64_t tailMask() const{
+            std::size_t used = length % word_bits;
+            return (used == 0 ? ~std::uint64_t(0) : (std::uint64_t(1) << used) - 1);
+        }
+
+        /**
+         * @brief Sets a raw bit and maintains the amount of set bits
+         */
+        void assign(std::size_t index, bool raw){
+            std::uint64_t& word = words[index / word_bits];
+            bool previous = (word & bit(index)) != 0;
+            if(previous != raw){
+                word ^= bit(index);
+                if(raw){
+                    bits++;
+                }else{
+                    bits--;
+                }
+            }
+        }
+
+        /**
+         * @brief Clears every bit and sets the inverted flag
+         */
+        void reset(bool value){
+            std::fill(words.begin(), words.end(), 0);
+            bits = 0;
+            inverted = value;
+        }
+
+        template<typename Element>
+        static std::size_t indexOf(const Element& element){
+            if constexpr(std::is_integral_v<Element>){
+                return static_cast<std::size_t>(element);
+            }else{
+                return static_cast<std::size_t>(element.index);
+            }
+        }
+    };
+}
@@ -43,31 +43,105 @@
 #include <string>
 
 #include "utils.hpp"
+#include "framebuffer.hpp"
+#include "keyboard.hpp"
+#include "eventloop.hpp"
+#include "histogram.hpp"
+#include "trace.hpp"
 
 namespace haevn::terminal::widgets{
     /**
      */
     class TextInput{
+    private:
+        /**
+         * @brief Text which was typed so far
+         */
+        std::string text;
+
     public:
         TextInput(){}
 
+        /**
+         * @brief Reads a line of text
+         * @details The typed characters are echoed, a pasted burst is echoed with a single write
+         * @return std::string Text without the line break
+         */
         std::string getText(){
-            char c;
-            std::string text;
-            std::cout << "Enter your text: ";
-            while((c = utils::Getchar::getch()) != 10){
-                if(c == 127){
-                    if(text.size() > 0){
-                        std::cout << "\b";
-                        text.pop_back();
-                    }
-                }else{
-                    text.push_back(c);
-                    std::cout << c;
+            utils::TerminalSession session;
+            start();
+            while(!handle(session, utils::KeyDecoder::read(session))){ }
+            return finish();
+        }
+
+#if defined(HAEVN_COROUTINES)
+        /**
+         * @brief Reads a line of text without blocking the event loop
+         * @details Asynchronous counterpart of getText
+         * @param loop Event loop which drives the input
+         * @return utils::Task<std::string> Text without the line break
+         */
+        utils::Task<std::string> getTextAsync(utils::EventLoop& loop){
+            utils::EventLoop::Terminal terminal = co_await loop.terminal();
+            utils::TerminalSession session;
+            start();
+            while(!handle(session, co_await terminal.key(session))){ }
+            co_return finish();
+        }
+#endif
+
+    private:
+        /**
+         * @brief Prints the prompt
+         */
+        void start(){
+            terminal::FrameBuffer& output = terminal::FrameBuffer::standard();
+            text.clear();
+            output += "Enter your text: ";
+            output.flush();
+        }
+
+        /**
+         * @brief Applies a key
+         * @param session Session which provides the input
+         * @param key Key which was typed
+         * @return true If the line is complete
+         */
+        bool handle(utils::TerminalSession& session, utils::keys key){
+            HAEVN_TRACE_SCOPE("textinput", "handle");
+            terminal::FrameBuffer& output = terminal::FrameBuffer::standard();
+            if(key == utils::keys::ENTER){
+                return true;
+            }
+            if(key == utils::keys::BACK_SPACE){
+                if(text.size() > 0){
+                    output += '\b';
+                    text.pop_back();
                 }
+            }else if(key == utils::keys::TAB || (key >= utils::keys::SPACE && key < utils::keys::F1)){
+                // Escape sequences like the arrow keys are decoded and dropped
+                text.push_back(static_cast<char>(key));
+                output += static_cast<char>(key);
+            }
+            if(session.buffered() == 0){
+                // Echo a pasted burst with a single write
+                bool wrote = !output.empty();
+                output.flush();
+                utils::PaintLatency::painted(wrote);
             }
-            std::cout << std::endl;
-            return text;
+            return false;
+        }
+
+        /**
+         * @brief Ends the line
+         * @return std::string Text which was typed
+         */
+        std::string finish(){
+            terminal::FrameBuffer& output = terminal::FrameBuffer::standard();
+            output += '\n';
+            output.flush();
+            utils::PaintLatency::painted();
+            return std::move(text);
         }
     };
 }
\ No newline at end of file
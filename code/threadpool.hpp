@@ -0,0 +1,270 @@
+/**
+ * @file This file contains a work stealing thread pool
+ * @details This file is licensed under the MIT license. If you decide to use this
+ *          file a copy of the following license must be provided. Giving credit in
+ *          form of a mention inside your source code, documentation or the final
+ *          product would be nice but is not required.
+ *
+ * Example
+ * +------------------------------------------------------------------------+
+ * |  haevn::utils::ThreadPool& pool = haevn::utils::ThreadPool::shared();  |
+ * |  haevn::utils::ThreadPool::Group group;                                |
+ * |  for(Chunk& chunk : chunks){                                           |
+ * |      pool.submit(group, [&chunk]{ chunk.process(); });                 |
+ * |  }                                                                     |
+ * |  pool.wait(group);                                                     |
+ * +------------------------------------------------------------------------+
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Nils Milewski (haevn)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+ * @author Nils Milewski
+ * @version 1.0.0.0
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace haevn::utils{
+
+    /**
+     * @brief This class contains a work stealing thread pool
+     * @details Every worker owns a task queue. Workers take tasks from the back of their own
+     *          queue and steal from the front of other queues once their queue is empty, so
+     *          unevenly sized tasks are balanced. Threads which wait for a group execute
+     *          pending tasks and only block while there is nothing to take, therefore groups
+     *          can be waited for from inside a task.
+     */
+    class ThreadPool{
+    public:
+
+        /**
+         * @brief This class tracks a set of submitted tasks
+         */
+        class Group{
+        private:
+            friend class ThreadPool;
+            std::atomic<std::size_t> pending{0};
+
+        public:
+            /**
+             * @brief Indicates that all tasks of the group are finished
+             */
+            bool done() const{
+                return pending.load(std::memory_order_acquire) == 0;
+            }
+        };
+
+    private:
+
+        struct Task{
+            std::function<void()> function;
+            Group* group;
+        };
+
+        struct Queue{
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> workers;
+
+        std::mutex mutex;
+        std::condition_variable condition;
+
+        /**
+         * @brief Wakes threads inside wait when a group finished or a task was submitted
+         */
+        std::condition_variable finished;
+
+        /**
+         * @brief Amount of threads which block inside wait, guarded by mutex
+         */
+        std::size_t waiting = 0;
+
+        std::atomic<std::size_t> queued{0};
+        std::atomic<std::size_t> next{0};
+        bool stopping = false;
+
+    public:
+        /**
+         * @brief Construct a new thread pool
+         * @param threads Amount of workers, default one per hardware thread
+         */
+        explicit ThreadPool(unsigned int threads = std::thread::hardware_concurrency()){
+            threads = (threads > 0 ? threads : 1);
+            for(unsigned int i = 0; i < threads; i++){
+                queues.push_back(std::make_unique<Queue>());
+            }
+            for(unsigned int i = 0; i < threads; i++){
+                workers.emplace_back(&ThreadPool::run, this, i);
+            }
+        }
+
+        ~ThreadPool(){
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            condition.notify_all();
+            for(std::thread& worker : workers){
+                worker.join();
+            }
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        /**
+         * @brief Gets the thread pool which is shared by the widgets
+         * @return ThreadPool& Pool with one worker per hardware thread
+         */
+        static ThreadPool& shared(){
+            static ThreadPool instance;
+            return instance;
+        }
+
+        /**
+         * @brief Gets the amount of workers
+         */
+        std::size_t size() const{
+            return workers.size();
+        }
+
+        /**
+         * @brief Submits a task
+         * @param group Group which tracks the task
+         * @param function Task which should be executed
+         */
+        void submit(Group& group, std::function<void()> function){
+            group.pending.fetch_add(1, std::memory_order_relaxed);
+            Queue& queue = *queues[next.fetch_add(1, std::memory_order_relaxed) % queues.size()];
+            {
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                queue.tasks.push_back(Task{std::move(function), &group});
+            }
+            bool helpers;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queued.fetch_add(1, std::memory_order_release);
+                helpers = (waiting > 0);
+            }
+            condition.notify_one();
+            if(helpers){
+                finished.notify_all();
+            }
+        }
+
+        /**
+         * @brief Waits until all tasks of a group are finished
+         * @details The calling thread executes pending tasks while it waits. Once there is
+         *          nothing to take it sleeps until the group finished or a task was submitted.
+         * @param group Group which should be finished
+         */
+        void wait(Group& group){
+            while(!group.done()){
+                Task task;
+                if(take(queues.size(), task)){
+                    execute(task);
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(mutex);
+                waiting++;
+                finished.wait(lock, [this, &group]{ return group.done() || queued.load(std::memory_order_acquire) > 0; });
+                waiting--;
+            }
+        }
+
+    private:
+
+        /**
+         * @brief Takes a task, the own queue first, then steals from the others
+         * @param index Index of the own queue, queues.size() for threads outside the pool
+         * @param task Task which was taken
+         * @return true If a task was taken
+         */
+        bool take(std::size_t index, Task& task){
+            if(index < queues.size()){
+                Queue& own = *queues[index];
+                std::lock_guard<std::mutex> lock(own.mutex);
+                if(!own.tasks.empty()){
+                    task = std::move(own.tasks.back());
+                    own.tasks.pop_back();
+                    queued.fetch_sub(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+            for(std::size_t i = 1; i <= queues.size(); i++){
+                Queue& other = *queues[(index + i) % queues.size()];
+                std::lock_guard<std::mutex> lock(other.mutex);
+                if(!other.tasks.empty()){
+                    task = std::move(other.tasks.front());
+                    other.tasks.pop_front();
+                    queued.fetch_sub(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * @brief Executes a task and marks it finished inside its group
+         */
+        void execute(Task& task){
+            task.function();
+            if(task.group->pending.fetch_sub(1, std::memory_order_acq_rel) == 1){
+                // The lock orders the notification after the predicate check of a waiter
+                std::lock_guard<std::mutex> lock(mutex);
+                finished.notify_all();
+            }
+        }
+
+        /**
+         * @brief Worker thread
+         * @param index Index of the own queue
+         */
+        void run(std::size_t index){
+            while(true){
+                Task task;
+                if(take(index, task)){
+                    execute(task);
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [this]{ return stopping || queued.load(std::memory_order_acquire) > 0; });
+                if(stopping){
+                    return;
+                }
+            }
+        }
+    };
+}
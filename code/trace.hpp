@@ -0,0 +1,240 @@
+/**
+ * @file This file contains an optional trace of the widget phases
+ * @details This file is licensed under the MIT license. If you decide to use this
+ *          file a copy of the following license must be provided. Giving credit in
+ *          form of a mention inside your source code, documentation or the final
+ *          product would be nice but is not required.
+ *          The trace is compiled out unless HAEVN_TRACE is defined, the macros expand to
+ *          nothing then. If it is compiled in, it records once the environment variable
+ *          HAEVN_TRACE_FILE names an output file or Trace::enable was called. The file is
+ *          written at exit in the Chrome trace event format, open it with Perfetto or
+ *          chrome://tracing.
+ *
+ * Example
+ * +--------------------------------------------------------------------+
+ * |  g++ -DHAEVN_TRACE -pthread main.cpp                               |
+ * |  HAEVN_TRACE_FILE=trace.json ./a.out                               |
+ * |                                                                    |
+ * |  void draw(){                                                      |
+ * |      HAEVN_TRACE_SCOPE("menu", "draw");                            |
+ * |      ...                                                           |
+ * |  }                                                                 |
+ * +--------------------------------------------------------------------+
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Nils Milewski (haevn)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+ * @author Nils Milewski
+ * @version 1.0.0.0
+ */
+#pragma once
+
+#if defined(HAEVN_TRACE)
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+extern "C"{
+    #include <unistd.h>
+}
+
+namespace haevn::utils{
+
+    /**
+     * @brief This class records the phases of the widgets
+     * @details Every thread appends its events to an own buffer, recording an event costs
+     *          two clock reads and no lock. Names and categories must be string literals.
+     */
+    class Trace{
+    public:
+        struct Event{
+            const char* category;
+            const char* name;
+            std::int64_t start;
+            std::int64_t duration;
+        };
+
+    private:
+        struct Buffer{
+            int tid;
+            std::vector<Event> events;
+        };
+
+        struct State{
+            std::atomic<bool> enabled{false};
+            std::mutex mutex;
+            std::string path;
+            std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+
+            /**
+             * @brief Buffers of all threads, they outlive their threads
+             */
+            std::vector<std::unique_ptr<Buffer>> buffers;
+
+            State(){
+                const char* file = std::getenv("HAEVN_TRACE_FILE");
+                if(file != nullptr && file[0] != '\0'){
+                    enable(*this, file);
+                }
+            }
+        };
+
+        static State& state(){
+            // Never destroyed, the exit handler may run after static destructors
+            static State* instance = new State();
+            return *instance;
+        }
+
+        static void enable(State& s, const char* path){
+            std::lock_guard<std::mutex> lock(s.mutex);
+            bool registered = !s.path.empty();
+            s.path = path;
+            if(!registered){
+                std::atexit(&Trace::onExit);
+            }
+            s.enabled.store(true, std::memory_order_release);
+        }
+
+        static void onExit(){
+            write();
+        }
+
+    public:
+
+        /**
+         * @brief Indicates that events are recorded
+         */
+        static bool enabled(){
+            return state().enabled.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Starts recording
+         * @param path File which is written at exit
+         */
+        static void enable(const char* path){
+            enable(state(), path);
+        }
+
+        /**
+         * @brief Gets the current time of the trace
+         * @return std::int64_t Nanoseconds since the trace was created
+         */
+        static std::int64_t now(){
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - state().origin).count();
+        }
+
+        /**
+         * @brief Records a complete event
+         * @param category Category, e.g. the widget
+         * @param name Name of the phase
+         * @param start Start as returned by now()
+         * @param duration Duration in nanoseconds
+         */
+        static void record(const char* category, const char* name, std::int64_t start, std::int64_t duration){
+            thread_local Buffer* buffer = nullptr;
+            if(buffer == nullptr){
+                State& s = state();
+                std::lock_guard<std::mutex> lock(s.mutex);
+                s.buffers.push_back(std::make_unique<Buffer>());
+                buffer = s.buffers.back().get();
+                buffer->tid = static_cast<int>(s.buffers.size());
+            }
+            buffer->events.push_back(Event{category, name, start, duration});
+        }
+
+        /**
+         * @brief Writes the recorded events in the Chrome trace event format
+         * @details Called at exit, threads should not record meanwhile
+         * @return true If the file was written
+         */
+        static bool write(){
+            State& s = state();
+            std::lock_guard<std::mutex> lock(s.mutex);
+            if(s.path.empty()){
+                return false;
+            }
+            std::FILE* file = std::fopen(s.path.c_str(), "w");
+            if(file == nullptr){
+                return false;
+            }
+            int pid = static_cast<int>(getpid());
+            bool first = true;
+            std::fputs("{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n", file);
+            for(const std::unique_ptr<Buffer>& buffer : s.buffers){
+                for(const Event& event : buffer->events){
+                    std::fprintf(file, "%s{\"cat\": \"%s\", \"name\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": %d, \"tid\": %d}",
+                                 (first ? "" : ",\n"), event.category, event.name, event.start / 1000.0, event.duration / 1000.0, pid, buffer->tid);
+                    first = false;
+                }
+            }
+            std::fputs("\n]}\n", file);
+            return std::fclose(file) == 0;
+        }
+    };
+
+    /**
+     * @brief Records the lifetime of a scope as an event
+     */
+    class TraceScope{
+    private:
+        const char* category;
+        const char* name;
+        std::int64_t start = -1;
+    public:
+        TraceScope(const char* category_t, const char* name_t) : category(category_t), name(name_t){
+            if(Trace::enabled()){
+                start = Trace::now();
+            }
+        }
+
+        ~TraceScope(){
+            if(start >= 0){
+                Trace::record(category, name, start, Trace::now() - start);
+            }
+        }
+
+        TraceScope(const TraceScope&) = delete;
+        TraceScope& operator=(const TraceScope&) = delete;
+    };
+}
+
+#define HAEVN_TRACE_JOIN_LINE(prefix, line) prefix##line
+#define HAEVN_TRACE_JOIN(prefix, line) HAEVN_TRACE_JOIN_LINE(prefix, line)
+
+/**
+ * @brief Records the rest of the enclosing scope
+ */
+#define HAEVN_TRACE_SCOPE(category, name) haevn::utils::TraceScope HAEVN_TRACE_JOIN(haevn_trace_scope_, __LINE__)(category, name)
+
+#else
+
+#define HAEVN_TRACE_SCOPE(category, name) do{ }while(false)
+
+#endif
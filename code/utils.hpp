@@ -40,6 +40,11 @@
 #include <iomanip>
 #include <chrono>
 #include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cerrno>
+#include <csignal>
+#include <atomic>
 
 #include <cstdint>
 
@@ -50,6 +55,8 @@ extern "C"
     #include <sys/ioctl.h>
     #include <sys/stat.h>
     #include <unistd.h>
+    #include <poll.h>
+    #include <fcntl.h>
 }
 
 
@@ -109,69 +116,449 @@ namespace haevn::utils{
     }
 
 
-    class Getchar{
-        public:
+    /**
+     * @brief This structure describes the size of the terminal
+     */
+    struct TerminalSize{
+        /**
+         * @brief Amount of rows
+         */
+        unsigned short rows = 24;
 
-        char static getch_timed(unsigned int seconds){
-            
-        }
+        /**
+         * @brief Amount of columns
+         */
+        unsigned short columns = 80;
+    };
 
-        char static getch(){
-            static Getchar instance;
-            return instance.getch_(0);
+    /**
+     * @brief This method gets the size of the terminal
+     * @details If the size can not be queried, e.g. the output is no terminal, 80x24 is returned
+     * @param fd File descriptor of the terminal, default stdout
+     * @return TerminalSize Size of the terminal
+     */
+    static inline TerminalSize terminalSize(int fd = STDOUT_FILENO){
+        TerminalSize size;
+        struct winsize window;
+        if(ioctl(fd, TIOCGWINSZ, &window) == 0 && window.ws_row > 0 && window.ws_col > 0){
+            size.rows = window.ws_row;
+            size.columns = window.ws_col;
         }
+        return size;
+    }
 
-        std::string static getch(int amount){
-            static Getchar instance;
-            std::string str;
-            for(int i = 0; i < amount; i++){
-                char c = instance.getch_(0);
-                str.push_back(c);
+    /**
+     * @brief This class caches the size of the terminal
+     * @details The size is queried once and cached, a SIGWINCH handler marks the cache as
+     *          stale so the next call queries it again. Widgets can ask for the size every
+     *          frame without an ioctl per frame. The previous SIGWINCH handler is still
+     *          called. If SIGWINCH is blocked, e.g. by a Reactor, invalidate must be called.
+     */
+    class TerminalGeometry{
+        private:
+            struct State{
+                /**
+                 * @brief Incremented by every SIGWINCH
+                 */
+                std::atomic<std::uint32_t> generation{1};
+
+                /**
+                 * @brief Generation in the upper, rows and columns in the lower half, 0 if nothing is cached
+                 */
+                std::atomic<std::uint64_t> cached{0};
+
+                /**
+                 * @brief File descriptor which was queried
+                 */
+                std::atomic<int> fd{-1};
+
+                std::atomic<bool> installed{false};
+                struct sigaction previous;
+            };
+
+            static State& state(){
+                static State instance;
+                return instance;
+            }
+
+        public:
+
+            /**
+             * @brief Gets the cached size of the terminal
+             * @param fd File descriptor of the terminal, default stdout
+             * @return TerminalSize Size of the terminal, 80x24 if it is no terminal
+             */
+            static TerminalSize size(int fd = STDOUT_FILENO){
+                State& s = state();
+                install();
+                std::uint32_t generation = s.generation.load(std::memory_order_acquire);
+                std::uint64_t cached = s.cached.load(std::memory_order_acquire);
+                if((cached >> 32) != generation || s.fd.load(std::memory_order_relaxed) != fd){
+                    TerminalSize queried = terminalSize(fd);
+                    s.fd.store(fd, std::memory_order_relaxed);
+                    cached = (static_cast<std::uint64_t>(generation) << 32) | (static_cast<std::uint32_t>(queried.rows) << 16) | queried.columns;
+                    s.cached.store(cached, std::memory_order_release);
+                    return queried;
+                }
+                TerminalSize result;
+                result.rows = static_cast<unsigned short>(cached >> 16);
+                result.columns = static_cast<unsigned short>(cached);
+                return result;
+            }
+
+            /**
+             * @brief Marks the cached size as stale
+             */
+            static void invalidate(){
+                state().generation.fetch_add(1, std::memory_order_acq_rel);
             }
-            return str;
-        }
 
         private:
 
-            struct termios old, current;
+            /**
+             * @brief Installs the SIGWINCH handler once
+             */
+            static void install(){
+                State& s = state();
+                bool expected = false;
+                if(s.installed.load(std::memory_order_acquire) || !s.installed.compare_exchange_strong(expected, true)){
+                    return;
+                }
+                struct sigaction action;
+                std::memset(&action, 0, sizeof(action));
+                action.sa_sigaction = &TerminalGeometry::onResize;
+                action.sa_flags = SA_RESTART | SA_SIGINFO;
+                sigemptyset(&action.sa_mask);
+                sigaction(SIGWINCH, &action, &s.previous);
+            }
 
-            Getchar(){}
+            static void onResize(int signal, siginfo_t* info, void* context){
+                State& s = state();
+                invalidate();
+                if(s.previous.sa_flags & SA_SIGINFO){
+                    if(s.previous.sa_sigaction != nullptr){
+                        s.previous.sa_sigaction(signal, info, context);
+                    }
+                }else if(s.previous.sa_handler != SIG_DFL && s.previous.sa_handler != SIG_IGN){
+                    s.previous.sa_handler(signal);
+                }
+            }
+    };
+
+    /**
+     * @brief This class contains a raw mode terminal session
+     * @details Creating the first session saves the terminal settings and switches the
+     *          input into noncanonical mode without echo. Nested sessions, e.g. a widget
+     *          which reads with Getchar, only increment a counter, therefore the terminal
+     *          settings are changed once per interaction and not per character.
+     *          The settings are restored when the last session is destroyed, during stack
+     *          unwinding, on exit and on SIGINT, SIGTERM, SIGHUP and SIGQUIT.
+     *          Input is read in blocks into a buffer shared by all sessions, so a paste
+     *          costs a single read syscall. Sessions should be used from one thread only.
+     *          If stdin is no terminal, e.g. entries are piped into a menu, the session reads
+     *          from /dev/tty instead.
+     */
+    class TerminalSession{
+        private:
+
+            /**
+             * @brief Signals after which the terminal settings are restored
+             */
+            static constexpr int handled_signals[4] = {SIGINT, SIGTERM, SIGHUP, SIGQUIT};
+
+            struct State{
+                /**
+                 * @brief Amount of living sessions
+                 */
+                int depth = 0;
+
+                /**
+                 * @brief File descriptor of the terminal
+                 */
+                int fd = STDIN_FILENO;
+
+                /**
+                 * @brief Indicates that saved contains settings which must be restored
+                 */
+                volatile sig_atomic_t modified = 0;
+
+                /**
+                 * @brief Terminal settings before the first session was created
+                 */
+                struct termios saved;
+
+                /**
+                 * @brief Signal handlers before the first session was created
+                 */
+                struct sigaction previous[4];
+
+                /**
+                 * @brief Indicates that the exit handler was registered
+                 */
+                bool exit_handler = false;
+
+                /**
+                 * @brief Input buffer, begin and end describe the unread part
+                 */
+                char buffer[4096];
+                std::size_t begin = 0;
+                std::size_t end = 0;
+
+                /**
+                 * @brief Called whenever input was read, nullptr if none is set
+                 */
+                void (*on_input)() = nullptr;
+            };
+
+            static State& state(){
+                static State instance;
+                return instance;
+            }
+
+        public:
 
             /**
-             * @brief Initializes a new terminal settings
-             * @param echo Enables/Disabled echo mode
+             * @brief Starts a new session
+             * @param echo Enables/Disables echo mode, only used by the outermost session
              */
-            void initTermios(int echo){
-                tcgetattr(0, &old); /* grab old terminal i/o settings */
-                current = old; /* make new settings same as old settings */
+            explicit TerminalSession(bool echo = false){
+                State& s = state();
+                if(s.depth++ > 0){
+                    return;
+                }
+                if(!isatty(STDIN_FILENO)){
+                    // Input is piped, e.g. into a streaming menu, keys are read from the terminal
+                    int tty = open("/dev/tty", O_RDWR | O_CLOEXEC);
+                    if(tty >= 0){
+                        s.fd = tty;
+                    }
+                }
+                if(tcgetattr(s.fd, &s.saved) != 0){
+                    return;
+                }
+
+                struct termios current = s.saved;
                 current.c_lflag &= ~ICANON; /* disable buffered i/o */
-                if (echo) {
-                    current.c_lflag |= ECHO; /* set echo mode */
-                } else {
-                    current.c_lflag &= ~ECHO; /* set no echo mode */
+                if(echo){
+                    current.c_lflag |= ECHO;
+                }else{
+                    current.c_lflag &= ~ECHO;
+                }
+                current.c_cc[VMIN] = 1;
+                current.c_cc[VTIME] = 0;
+
+                struct sigaction action;
+                std::memset(&action, 0, sizeof(action));
+                action.sa_handler = &TerminalSession::onSignal;
+                sigemptyset(&action.sa_mask);
+                for(int i = 0; i < 4; i++){
+                    sigaction(handled_signals[i], &action, &s.previous[i]);
                 }
-                tcsetattr(0, TCSANOW, &current); /* use these new terminal i/o settings now */
+                if(!s.exit_handler){
+                    std::atexit(&TerminalSession::onExit);
+                    s.exit_handler = true;
+                }
+
+                s.modified = 1;
+                tcsetattr(s.fd, TCSANOW, &current);
+            }
+
+            ~TerminalSession(){
+                State& s = state();
+                if(--s.depth > 0){
+                    return;
+                }
+                if(s.modified){
+                    restore();
+                    for(int i = 0; i < 4; i++){
+                        sigaction(handled_signals[i], &s.previous[i], nullptr);
+                    }
+                }
+                if(s.fd != STDIN_FILENO){
+                    close(s.fd);
+                    s.fd = STDIN_FILENO;
+                    s.begin = 0;
+                    s.end = 0;
+                }
+            }
+
+            TerminalSession(const TerminalSession&) = delete;
+            TerminalSession& operator=(const TerminalSession&) = delete;
+
+            /**
+             * @brief Reads one byte
+             * @details Blocks until input is available. The buffer is refilled with a single
+             *          read of all pending bytes.
+             * @return int Byte which was read or EOF
+             */
+            int get(){
+                State& s = state();
+                if(s.begin == s.end && !fill()){
+                    return EOF;
+                }
+                return static_cast<unsigned char>(s.buffer[s.begin++]);
+            }
+
+            /**
+             * @brief Reads one byte with a deadline
+             * @details Waits at most \p timeout_ms milliseconds for input.
+             * @param timeout_ms Timeout in milliseconds, negative values block
+             * @return int Byte which was read or EOF if nothing arrived in time
+             */
+            int get(int timeout_ms){
+                if(!wait(timeout_ms)){
+                    return EOF;
+                }
+                return get();
+            }
+
+            /**
+             * @brief Waits until input is available
+             * @details Returns immediately if bytes are buffered, otherwise polls the terminal.
+             *          Interrupted polls continue with the remaining time, so the deadline holds.
+             * @param timeout_ms Timeout in milliseconds, negative values block
+             * @return true If a byte can be read without blocking
+             */
+            bool wait(int timeout_ms){
+                State& s = state();
+                if(s.begin != s.end){
+                    return true;
+                }
+                auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+                struct pollfd descriptor = {s.fd, POLLIN, 0};
+                while(true){
+                    int remaining = timeout_ms;
+                    if(timeout_ms >= 0){
+                        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+                        remaining = (left.count() > 0 ? left.count() : 0);
+                    }
+                    int result = poll(&descriptor, 1, remaining);
+                    if(result >= 0){
+                        return result > 0;
+                    }
+                    if(errno != EINTR){
+                        return false;
+                    }
+                }
+            }
+
+            /**
+             * @brief Gets the amount of bytes which can be read without a syscall
+             * @return std::size_t Amount of buffered bytes
+             */
+            std::size_t buffered() const{
+                return state().end - state().begin;
+            }
+
+            /**
+             * @brief Gets the file descriptor of the terminal
+             * @return int File descriptor
+             */
+            int fd() const{
+                return state().fd;
+            }
+
+            /**
+             * @brief Sets a function which is called whenever input was read
+             * @details Used by PaintLatency of histogram.hpp, which installs it when included
+             * @param callback Function which is called, nullptr removes it
+             */
+            static void onInput(void (*callback)()){
+                state().on_input = callback;
             }
 
+        private:
+
             /**
-             * @brief Resets the old terminal
+             * @brief Reads all pending bytes into the buffer
+             * @return true If at least one byte was read
              */
-            void resetTermios(void){
-                tcsetattr(0, TCSANOW, &old);
+            bool fill(){
+                State& s = state();
+                ssize_t amount;
+                do{
+                    amount = ::read(s.fd, s.buffer, sizeof(s.buffer));
+                }while(amount < 0 && errno == EINTR);
+
+                s.begin = 0;
+                s.end = (amount > 0 ? amount : 0);
+                if(amount > 0 && s.on_input != nullptr){
+                    s.on_input();
+                }
+                return amount > 0;
             }
 
             /**
-             * @brief Read 1 char from terminal
-             * @param echo Enables/Disables echo mode
-             * @return char Character which was read
+             * @brief Restores the saved terminal settings
              */
-            char getch_(int echo){
-                char ch;
-                initTermios(echo);
-                ch = getchar();
-                resetTermios();
-                return ch;
+            static void restore(){
+                State& s = state();
+                if(s.modified){
+                    tcsetattr(s.fd, TCSANOW, &s.saved);
+                    s.modified = 0;
+                }
+            }
+
+            static void onExit(){
+                restore();
+            }
+
+            static void onSignal(int signal){
+                State& s = state();
+                restore();
+                for(int i = 0; i < 4; i++){
+                    if(handled_signals[i] == signal){
+                        sigaction(signal, &s.previous[i], nullptr);
+                    }
+                }
+                raise(signal);
+            }
+    };
+
+    class Getchar{
+        public:
+
+        /**
+         * @brief Reads 1 char from the terminal with a deadline
+         * @param seconds Maximum time to wait for input
+         * @return char Character which was read or '\0' if the deadline passed
+         */
+        char static getch_timed(unsigned int seconds){
+            TerminalSession session;
+            // Converted in 64 bit and clamped, seconds * 1000 overflows an int
+            std::chrono::milliseconds::rep milliseconds = std::chrono::milliseconds(std::chrono::seconds(seconds)).count();
+            int c = session.get(milliseconds < std::numeric_limits<int>::max() ? static_cast<int>(milliseconds) : std::numeric_limits<int>::max());
+            return (c == EOF ? '\0' : c);
+        }
+
+        /**
+         * @brief Reads 1 char from the terminal
+         * @details Uses the active TerminalSession or opens one for this character
+         * @return char Character which was read
+         */
+        char static getch(){
+            TerminalSession session;
+            return session.get();
+        }
+
+        /**
+         * @brief Reads \p amount characters from the terminal
+         * @param amount Amount of characters
+         * @return std::string Characters which were read
+         */
+        std::string static getch(int amount){
+            TerminalSession session;
+            std::string str;
+            for(int i = 0; i < amount; i++){
+                char c = session.get();
+                str.push_back(c);
             }
+            return str;
+        }
+
+        private:
+
+            Getchar(){}
     };
 
 
@@ -60,8 +60,13 @@ extern "C"
 
 }
 
-#include "utils.hpp"
 #include "colors.hpp"
+#include "utils.hpp"
+#include "keyboard.hpp"
+#include "screen.hpp"
+#include "eventloop.hpp"
+#include "histogram.hpp"
+#include "trace.hpp"
 
 namespace haevn::terminal::widgets{
 
@@ -75,13 +80,13 @@ namespace haevn::terminal::widgets{
         /**
          * @brief Background color
          */
-        const char* background = terminal::colors::background::CYAN;
-        const char* fill = terminal::colors::background::MAGENTA;
+        terminal::colors::Style background = terminal::colors::style::background::CYAN;
+        terminal::colors::Style fill = terminal::colors::style::background::MAGENTA;
 
         /**
          * @brief foregrounds color
          */
-        const char* foreground = terminal::colors::foreground::BLUE;
+        terminal::colors::Style foreground = terminal::colors::style::foreground::BLUE;
         char increment_key = 'd';
         char decrement_key = 'a';
     };
@@ -90,6 +95,12 @@ namespace haevn::terminal::widgets{
     private:
         ValueSliderSettings* settings_m;
         int value = 0;
+
+        /**
+         * @brief Value change of a single key press
+         */
+        int step = 1;
+        Screen screen;
     public:
 
         ValueSlider(){
@@ -110,50 +121,140 @@ namespace haevn::terminal::widgets{
             if(settings()->minimum > settings()->maximum){
                 return -1;
             }
+            utils::TerminalSession session;
+            start();
+            while(true){
+                draw();
+                if(handle(utils::KeyDecoder::read(session))){
+                    break;
+                }
+            }
+            return finish();
+        }
+
+#if defined(HAEVN_COROUTINES)
+        /**
+         * @brief Prints the slider on the terminal without blocking the event loop
+         * @details Asynchronous counterpart of getValue
+         * @param loop Event loop which drives the slider
+         * @return utils::Task<int> Selected value, -1 if minimum is greater than maximum
+         */
+        utils::Task<int> getValueAsync(utils::EventLoop& loop){
+            if(settings()->minimum > settings()->maximum){
+                co_return -1;
+            }
+            utils::EventLoop::Terminal terminal = co_await loop.terminal();
+            utils::TerminalSession session;
+            start();
+            while(true){
+                draw();
+                if(handle(co_await terminal.key(session))){
+                    break;
+                }
+            }
+            co_return finish();
+        }
+#endif
+
+    private:
+        /**
+         * @brief Starts a selection
+         */
+        void start(){
             if(settings()->clear_cache){
                 char c2;
                 while ((c2 = haevn::utils::Getchar::getch()) != '\n' && c2 != EOF) { }
             }
  
             value = settings()->minimum;
-            int step = (settings()->maximum - settings()->minimum) / 50;
+            step = (settings()->maximum - settings()->minimum) / 50;
             step = (step == 0 ? 1 : step);
-            char c;
-            while(true){
-                
-                std::system("clear");
-                std::cout << terminal::colors::CLEAR << settings()->message << " " << utils::dateTime() << std::endl;
-                std::cout << "Use " << settings()->decrement_key << "/" << settings()->increment_key <<" to change the value and <ENTER> to select" << std::endl
-                          << std::endl << "("<< settings()->minimum << ")[" << settings()->foreground;
-                    
-                
-                for(int i = 0; i < 50; i++){
-                    if(i < ((value - settings()->minimum) / step)){
-                        std::cout << settings()->fill << settings()->fill_character;
-                    }else{
-                        std::cout << settings()->background << " ";
-                    }
-                }
-                std::cout << haevn::terminal::colors::RESET << "](" << (value) << "/" << settings()->maximum << ")";
-
-                c = utils::Getchar::getch();
-                if(c == settings()->decrement_key){
-                    value -= step;
-                    if(value < settings()->minimum){
-                        value = settings()->minimum;
-                    }
-                }
+        }
+
+        /**
+         * @brief Draws a frame of the slider
+         */
+        void draw(){
+            HAEVN_TRACE_SCOPE("valueslider", "draw");
+            screen.begin();
+
+            std::string& title = screen.line();
+            title += settings()->message;
+            title += ' ';
+            title += utils::dateTime();
 
-                if(c == settings()->increment_key){
-                    value += step;
-                    if(value >= settings()->maximum){
-                        value = settings()->maximum;
-                    }
+            std::string& help = screen.line();
+            help += "Use ";
+            help += settings()->decrement_key;
+            help += '/';
+            help += settings()->increment_key;
+            help += " to change the value and <ENTER> to select";
+
+            screen.line();
+
+            std::string minimum = std::to_string(settings()->minimum);
+            std::string maximum = std::to_string(settings()->maximum);
+
+            // The slider fills the cached terminal width, value takes at most as many digits as maximum
+            int columns = utils::TerminalGeometry::size(FrameBuffer::standard().fd()).columns;
+            int cells = columns - static_cast<int>(minimum.size() + 2 * maximum.size()) - 8;
+            cells = (cells < 10 ? 10 : cells);
+            int range = settings()->maximum - settings()->minimum;
+            int filled = (range > 0 ? static_cast<int>(static_cast<long long>(value - settings()->minimum) * cells / range) : cells);
+
+            std::string& bar = screen.line();
+            bar += '(';
+            bar += minimum;
+            bar += ")[";
+            terminal::colors::StyleTracker style;
+            if(filled > 0){
+                style.apply(bar, settings()->foreground | settings()->fill);
+                bar.append(filled, settings()->fill_character);
+            }
+            if(cells > filled){
+                style.apply(bar, settings()->foreground | settings()->background);
+                bar.append(cells - filled, ' ');
+            }
+            style.reset(bar);
+            bar += "](";
+            bar += std::to_string(value);
+            bar += '/';
+            bar += maximum;
+            bar += ')';
+
+            utils::PaintLatency::painted(screen.present());
+        }
+
+        /**
+         * @brief Applies a key
+         * @param key Key which was typed
+         * @return true If the value is selected
+         */
+        bool handle(utils::keys key){
+            HAEVN_TRACE_SCOPE("valueslider", "handle");
+            if(key == settings()->decrement_key || key == utils::keys::ARROW_LEFT){
+                value -= step;
+                if(value < settings()->minimum){
+                    value = settings()->minimum;
                 }
-                if(c == 10){
-                    break;
+            }
+
+            if(key == settings()->increment_key || key == utils::keys::ARROW_RIGHT){
+                value += step;
+                if(value >= settings()->maximum){
+                    value = settings()->maximum;
                 }
             }
+            return (key == utils::keys::ENTER);
+        }
+
+        /**
+         * @brief Ends a selection
+         * @return int Selected value
+         */
+        int finish(){
+            screen.release();
+            utils::PaintLatency::painted();
             return value;
         }
     };
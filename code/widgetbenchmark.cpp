@@ -0,0 +1,324 @@
+#include "widgets.hpp"
+#include "ptydriver.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Measures the cost of a keystroke for every widget on a pseudo terminal
+ * Every widget is driven by a key script for list sizes from 10 to 10M entries and
+ * terminal sizes from 80x24 to 400x120. The results are printed as JSON:
+ *   ns_per_keystroke       median time from writing a key until its frame arrived
+ *   bytes_per_frame        bytes written by the widget divided by its frames
+ *   syscalls_per_frame     write syscalls of the frame buffer divided by its frames
+ *   allocations_per_frame  operator new calls while the widget ran divided by its frames
+ * ProgressBar::update, ConcurrentProgressBar::update and the handles of ProgressGroup are
+ * measured in tight loops.
+ * Usage: ./widgetbenchmark [max_entries] [keystrokes] > results.json
+ */
+
+static std::atomic<std::uint64_t> allocations{0};
+
+/**
+ * Counts and allocates, shared by all forms of operator new
+ */
+static void* allocate(std::size_t size){
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* memory = std::malloc(size > 0 ? size : 1);
+    if(memory == nullptr){
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+/**
+ * Frees memory of allocate, shared by all forms of operator delete
+ */
+static void release(void* memory) noexcept{
+    std::free(memory);
+}
+
+void* operator new(std::size_t size){
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size){
+    return allocate(size);
+}
+
+void operator delete(void* memory) noexcept{
+    release(memory);
+}
+
+void operator delete[](void* memory) noexcept{
+    release(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept{
+    release(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept{
+    release(memory);
+}
+
+/**
+ * Provides generated entries, so 10M entries take no memory
+ */
+class SyntheticProvider : public haevn::utils::EntryProvider{
+private:
+    std::size_t amount;
+public:
+    explicit SyntheticProvider(std::size_t amount_t) : amount(amount_t){}
+
+    std::size_t size() const override{
+        return amount;
+    }
+
+    std::string_view at(std::size_t index) const override{
+        static const char* words[] = {"alpha", "beta", "gamma", "delta", "prod", "stage", "web", "db"};
+        thread_local char buffer[64];
+        char* end = buffer;
+        for(int k = 0; k < 3; k++){
+            const char* word = words[(index >> (3 * k)) & 7];
+            while(*word != '\0'){
+                *end++ = *word++;
+            }
+            *end++ = '-';
+        }
+        end = std::to_chars(end, buffer + sizeof(buffer), index).ptr;
+        return std::string_view(buffer, end - buffer);
+    }
+};
+
+struct Case{
+    const char* widget;
+    std::size_t entries;
+    unsigned short rows;
+    unsigned short columns;
+};
+
+/**
+ * Prints one result as a JSON object
+ */
+static void report(const Case& current, const haevn::utils::PtyDriver::Result& result, std::uint64_t allocated, bool& first){
+    std::vector<long long> latencies;
+    for(std::size_t i = 0; i + 1 < result.latencies.size(); i++){
+        // The last key ends the widget, its frame is the final one
+        if(result.latencies[i].count() >= 0){
+            latencies.push_back(result.latencies[i].count());
+        }
+    }
+    std::sort(latencies.begin(), latencies.end());
+    long long median = (latencies.empty() ? -1 : latencies[latencies.size() / 2]);
+    long long p99 = (latencies.empty() ? -1 : latencies[latencies.size() * 99 / 100]);
+    double frames = static_cast<double>(result.frames > 0 ? result.frames : 1);
+
+    std::printf("%s    {\"widget\": \"%s\", \"entries\": %zu, \"rows\": %u, \"columns\": %u, \"keystrokes\": %zu, "
+                "\"finished\": %s, \"ns_per_keystroke\": %lld, \"ns_per_keystroke_p99\": %lld, \"frames\": %llu, "
+                "\"bytes_per_frame\": %.1f, \"syscalls_per_frame\": %.3f, \"allocations_per_frame\": %.3f}",
+                (first ? "" : ",\n"), current.widget, current.entries, current.rows, current.columns, result.latencies.size(),
+                (result.finished ? "true" : "false"), median, p99, static_cast<unsigned long long>(result.frames),
+                result.output.size() / frames, result.syscalls / frames, allocated / frames);
+    std::fflush(stdout);
+    first = false;
+}
+
+/**
+ * Prints the result of a tight loop as a JSON object
+ */
+static void reportLoop(const Case& current, const haevn::utils::PtyDriver::Result& result, bool& first){
+    unsigned long long iterations = 0;
+    double ns = 0;
+    unsigned long long allocated = 0;
+    std::sscanf(result.value.c_str(), "%llu %lf %llu", &iterations, &ns, &allocated);
+    double frames = static_cast<double>(result.frames > 0 ? result.frames : 1);
+
+    std::printf("%s    {\"widget\": \"%s\", \"rows\": %u, \"columns\": %u, \"iterations\": %llu, \"finished\": %s, "
+                "\"ns_per_update\": %.2f, \"frames\": %llu, \"bytes_per_frame\": %.1f, \"syscalls_per_frame\": %.3f, "
+                "\"allocations_per_frame\": %.3f}",
+                (first ? "" : ",\n"), current.widget, current.rows, current.columns, iterations, (result.finished ? "true" : "false"),
+                ns, static_cast<unsigned long long>(result.frames), result.output.size() / frames, result.syscalls / frames, allocated / frames);
+    std::fflush(stdout);
+    first = false;
+}
+
+/**
+ * Runs a widget and returns the allocations of the widget call through the driver
+ */
+template<typename Widget>
+static haevn::utils::PtyDriver::Result drive(haevn::utils::PtyDriver& driver, Widget widget, const std::vector<std::string>& script, std::uint64_t& allocated){
+    haevn::utils::PtyDriver::Result result = driver.run([&]{
+        std::uint64_t before = allocations.load(std::memory_order_relaxed);
+        widget();
+        return std::to_string(allocations.load(std::memory_order_relaxed) - before);
+    }, script);
+    allocated = std::strtoull(result.value.c_str(), nullptr, 10);
+    return result;
+}
+
+int main(int argc, char** argv){
+    std::size_t max_entries = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000);
+    std::size_t keystrokes = (argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000);
+
+    const std::size_t sizes[] = {10, 1000, 100000, 10000000};
+    const unsigned short terminals[][2] = {{24, 80}, {48, 160}, {120, 400}};
+    const std::string down = "\x1B[B";
+    std::string header = "Benchmark";
+
+    std::printf("{\n  \"keystrokes\": %zu,\n  \"results\": [\n", keystrokes);
+    bool first = true;
+    std::uint64_t allocated = 0;
+
+    for(const unsigned short* terminal : terminals){
+        haevn::utils::PtyDriverSettings settings;
+        settings.rows = terminal[0];
+        settings.columns = terminal[1];
+        haevn::utils::PtyDriver driver(settings);
+
+        for(std::size_t entries : sizes){
+            if(entries > max_entries){
+                continue;
+            }
+            SyntheticProvider provider(entries);
+
+            std::vector<std::string> navigation(keystrokes, down);
+            navigation.push_back("\r");
+            Case current{"menu", entries, terminal[0], terminal[1]};
+            haevn::utils::PtyDriver::Result result = drive(driver, [&]{
+                haevn::terminal::widgets::Menu menu(provider, header);
+                menu.getSelection();
+            }, navigation, allocated);
+            report(current, result, allocated, first);
+
+            // Every character filters the whole list, every backspace is served from a stored prefix
+            std::vector<std::string> typing = {"w", "e", "b", "d", "b", "3", "\x7F", "\x7F", "\x7F", "\x7F", "\x7F", "\x7F", "\r"};
+            current.widget = "menu_filter";
+            result = drive(driver, [&]{
+                haevn::terminal::widgets::Menu menu(provider, header);
+                menu.settings()->filter = true;
+                menu.getSelection();
+            }, typing, allocated);
+            report(current, result, allocated, first);
+
+            std::vector<std::string> toggling;
+            for(std::size_t i = 0; i < keystrokes; i++){
+                toggling.push_back(i % 2 == 0 ? "\n" : down);
+            }
+            toggling.push_back("q");
+            current.widget = "checkbox";
+            result = drive(driver, [&]{
+                haevn::terminal::widgets::CheckBox box(provider, header);
+                box.settings()->update_entries = false;
+                box.selectItems();
+            }, toggling, allocated);
+            report(current, result, allocated, first);
+
+            navigation.back() = "q";
+            current.widget = "radiobutton";
+            result = drive(driver, [&]{
+                haevn::terminal::widgets::RadioButton radio(provider, header);
+                radio.selectItems();
+            }, navigation, allocated);
+            report(current, result, allocated, first);
+        }
+
+        std::vector<std::string> sliding;
+        for(std::size_t i = 0; i < keystrokes; i++){
+            sliding.push_back(i % 2 == 0 ? "d" : "a");
+        }
+        sliding.push_back("\r");
+        Case current{"valueslider", 0, terminal[0], terminal[1]};
+        haevn::utils::PtyDriver::Result result = drive(driver, [&]{
+            haevn::terminal::widgets::ValueSlider slider;
+            slider.getValue();
+        }, sliding, allocated);
+        report(current, result, allocated, first);
+
+        std::vector<std::string> text(keystrokes, "x");
+        text.push_back("\r");
+        current.widget = "textinput";
+        result = drive(driver, [&]{
+            haevn::terminal::widgets::TextInput input;
+            input.getText();
+        }, text, allocated);
+        report(current, result, allocated, first);
+
+        current.widget = "passwordinput";
+        result = drive(driver, [&]{
+            haevn::terminal::widgets::PasswordInput input;
+            input.getPassword('*');
+        }, text, allocated);
+        report(current, result, allocated, first);
+
+        // A pasted burst is a single step
+        current.widget = "textinput_paste";
+        result = drive(driver, [&]{
+            haevn::terminal::widgets::TextInput input;
+            input.getText();
+        }, {std::string(keystrokes, 'x'), "\r"}, allocated);
+        report(current, result, allocated, first);
+
+        const unsigned int iterations = 10000000;
+        current.widget = "progressbar_update";
+        result = driver.run([&]{
+            haevn::terminal::widgets::ProgressBar bar;
+            bar.settings()->maximum = iterations;
+            std::uint64_t before = allocations.load(std::memory_order_relaxed);
+            auto start = std::chrono::steady_clock::now();
+            for(unsigned int i = 0; i < iterations; i++){
+                bar.update();
+            }
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            return std::to_string(iterations) + ' ' + std::to_string(ns / iterations) + ' ' + std::to_string(allocations.load(std::memory_order_relaxed) - before);
+        }, {});
+        reportLoop(current, result, first);
+
+        current.widget = "concurrentprogressbar_update";
+        result = driver.run([&]{
+            haevn::terminal::widgets::ConcurrentProgressBar bar;
+            bar.settings()->maximum = iterations;
+            std::uint64_t before = allocations.load(std::memory_order_relaxed);
+            bar.start();
+            auto start = std::chrono::steady_clock::now();
+            for(unsigned int i = 0; i < iterations; i++){
+                bar.update();
+            }
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            bar.finish();
+            return std::to_string(iterations) + ' ' + std::to_string(ns / iterations) + ' ' + std::to_string(allocations.load(std::memory_order_relaxed) - before);
+        }, {});
+        reportLoop(current, result, first);
+
+        current.widget = "progressgroup_update";
+        result = driver.run([&]{
+            haevn::terminal::widgets::ProgressGroup group;
+            const unsigned int jobs = 16;
+            std::vector<haevn::terminal::widgets::ProgressGroup::Handle> handles;
+            for(unsigned int job = 0; job < jobs; job++){
+                handles.push_back(group.add("job " + std::to_string(job), iterations / jobs));
+            }
+            std::uint64_t before = allocations.load(std::memory_order_relaxed);
+            group.start();
+            auto start = std::chrono::steady_clock::now();
+            for(unsigned int i = 0; i < iterations; i++){
+                handles[i % jobs].update();
+            }
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            group.stop();
+            return std::to_string(iterations) + ' ' + std::to_string(ns / iterations) + ' ' + std::to_string(allocations.load(std::memory_order_relaxed) - before);
+        }, {});
+        reportLoop(current, result, first);
+    }
+
+    std::printf("\n  ]\n}\n");
+    return 0;
+}
@@ -0,0 +1,4 @@
+#!/bin/bash
+rm widgetbenchmark
+g++ -O2 -march=native -pthread widgetbenchmark.cpp -o widgetbenchmark
+./widgetbenchmark "$@"
@@ -1,9 +1,20 @@
 #pragma once
 #include "colors.hpp"
 #include "progressbar.hpp"
+#include "concurrentprogressbar.hpp"
+#include "progressgroup.hpp"
 #include "menu.hpp"
 #include "textinput.hpp"
 #include "passwordinput.hpp"
 #include "valueslider.hpp"
 #include "checkbox.hpp"
-#include "radiobutton.hpp"
\ No newline at end of file
+#include "radiobutton.hpp"
+#include "screen.hpp"
+#include "framebuffer.hpp"
+#include "fuzzy.hpp"
+#include "threadpool.hpp"
+#include "selectionset.hpp"
+#include "provider.hpp"
+#include "mappedfile.hpp"
+#include "reactor.hpp"
+#include "eventloop.hpp"
\ No newline at end of file